@@ -0,0 +1,194 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <thread>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+struct benchCommon
+{
+	typedef std::chrono::steady_clock clock_t;
+
+	// busy loop, keeps the cpu for the whole duration unlike sleep_for
+	template< class Rep, class Period >
+	static void spin(const std::chrono::duration<Rep, Period>& duration)
+	{
+		const auto endTime = clock_t::now() + duration;
+		while (clock_t::now() < endTime)
+		{
+		}
+	}
+
+	// p in [0, 100], sorts the samples
+	static double percentile(std::vector<double>& samples, double p)
+	{
+		if (samples.empty())
+			return 0;
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(p / 100.0 * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	// for the counting replacements of operator new, msvc has no std::aligned_alloc, its memory goes back with _aligned_free
+	static void* alignedAlloc(size_t size, size_t align)
+	{
+#if defined(_MSC_VER)
+		return _aligned_malloc(size ? size : 1, align);
+#else
+		return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+	}
+	static void alignedFree(void* p)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+
+	static size_t argOr(int argc, char* argv[], int index, size_t def)
+	{
+		if (argc > index)
+			return static_cast<size_t>(std::strtoull(argv[index], nullptr, 10));
+		return def;
+	}
+
+	static void printLatency(const std::string& name, std::vector<double>& latenciesUs, double seconds)
+	{
+		const double throughput = seconds > 0 ? static_cast<double>(latenciesUs.size()) / seconds : 0;
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+			<< " tasks/s: " << std::setw(12) << throughput
+			<< " p50 us: " << std::setw(10) << percentile(latenciesUs, 50)
+			<< " p99 us: " << std::setw(10) << percentile(latenciesUs, 99)
+			<< " p99.9 us: " << std::setw(10) << percentile(latenciesUs, 99.9)
+			<< " max us: " << std::setw(10) << percentile(latenciesUs, 100)
+			<< std::endl;
+	}
+};
+
+/*
+	results of bench_suite, printed like google benchmark does:
+	console (a table), json (--benchmark_format=json, same layout as google benchmark) or csv.
+	every result has a name with its parameters, e.g. throughput/producers:2/workers:4/hashed,
+	the time of one iteration and any number of named counters.
+*/
+struct benchResult
+{
+	std::string name;
+	size_t iterations{ 0 };
+	double realTimeNs{ 0 };		// per iteration
+	double itemsPerSecond{ 0 };
+	std::vector<std::pair<std::string, double>> counters;
+};
+
+class benchReporter final
+{
+public:
+	enum class format { console, json, csv };
+
+	static bool parseFormat(const std::string& name, format& out)
+	{
+		if (name == "console")
+			out = format::console;
+		else if (name == "json")
+			out = format::json;
+		else if (name == "csv")
+			out = format::csv;
+		else
+			return false;
+		return true;
+	}
+
+	void add(benchResult r)
+	{
+		if (_format == format::console)
+			printConsole(std::cout, r); // progress while the suite runs
+		_results.push_back(std::move(r));
+	}
+
+	void setFormat(format f) { _format = f; }
+
+	// console results are already printed, json and csv go to out at the end
+	void finish(std::ostream& out)const
+	{
+		if (_format == format::json)
+			writeJson(out);
+		else if (_format == format::csv)
+			writeCsv(out);
+	}
+
+private:
+	static void printConsole(std::ostream& out, const benchResult& r)
+	{
+		out << std::left << std::setw(48) << r.name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(14) << r.realTimeNs << " ns" << std::setw(12) << r.iterations;
+		if (r.itemsPerSecond > 0)
+			out << " items/s=" << r.itemsPerSecond;
+		for (const auto& [name, value] : r.counters)
+			out << " " << name << "=" << value;
+		out << std::endl;
+	}
+
+	static std::string escape(const std::string& s)
+	{
+		std::string res;
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				res += '\\';
+			res += c;
+		}
+		return res;
+	}
+
+	void writeJson(std::ostream& out)const
+	{
+		out << std::setprecision(6) << std::fixed;
+		out << "{\n  \"context\": {\n"
+			<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "    \"library\": \"threadpool\"\n  },\n"
+			<< "  \"benchmarks\": [";
+		for (size_t i = 0; i < _results.size(); ++i)
+		{
+			const auto& r = _results[i];
+			out << (i == 0 ? "\n" : ",\n") << "    {\n"
+				<< "      \"name\": \"" << escape(r.name) << "\",\n"
+				<< "      \"iterations\": " << r.iterations << ",\n"
+				<< "      \"real_time\": " << r.realTimeNs << ",\n"
+				<< "      \"time_unit\": \"ns\",\n"
+				<< "      \"items_per_second\": " << r.itemsPerSecond;
+			for (const auto& [name, value] : r.counters)
+				out << ",\n      \"" << escape(name) << "\": " << value;
+			out << "\n    }";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	void writeCsv(std::ostream& out)const
+	{
+		// counters differ between scenarios, they go in name=value pairs of the last column
+		out << "name,iterations,real_time,time_unit,items_per_second,counters\n";
+		out << std::setprecision(3) << std::fixed;
+		for (const auto& r : _results)
+		{
+			out << "\"" << r.name << "\"," << r.iterations << "," << r.realTimeNs << ",ns," << r.itemsPerSecond << ",\"";
+			for (size_t i = 0; i < r.counters.size(); ++i)
+				out << (i == 0 ? "" : ";") << r.counters[i].first << "=" << r.counters[i].second;
+			out << "\"\n";
+		}
+	}
+
+	format _format{ format::console };
+	std::vector<benchResult> _results;
+};
@@ -0,0 +1,123 @@
+#include "tp/coro.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+
+/*
+	cost of moving work to a worker with a coroutine resume vs an std::function task, allocations and ns per hop.
+
+	push(std::function)+get    - the caller pushes a task and waits for its future, once per hop
+	co_await schedule() caller - the caller starts a task that resumes on a worker and waits for it, once per hop
+	push(std::function) chain  - every task pushes the next one from the worker
+	co_await schedule() chain  - one coroutine resumes itself on the workers, the frame is reused
+
+	usage: bench_coro [numHops]
+*/
+
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t align)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = benchCommon::alignedAlloc(size, static_cast<size_t>(align)))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { benchCommon::alignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { benchCommon::alignedFree(p); }
+
+typedef concurency::threadPool<size_t> pool_t;
+
+template<typename Func>
+static void measure(const std::string& name, size_t numHops, Func&& func)
+{
+	func(numHops / 10); // warm up caches and pools
+
+	const size_t before = allocations.load();
+	const auto begin = benchCommon::clock_t::now();
+	func(numHops);
+	const double ns = std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - begin).count();
+	const size_t allocs = allocations.load() - before;
+
+	std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+		<< " allocs/hop: " << std::setw(8) << static_cast<double>(allocs) / static_cast<double>(numHops)
+		<< " ns/hop: " << std::setw(10) << ns / static_cast<double>(numHops) << std::endl;
+}
+
+static concurency::task<size_t> once(pool_t& tp, size_t v)
+{
+	co_await tp.schedule();
+	co_return v;
+}
+
+static concurency::task<size_t> chain(pool_t& tp, size_t n)
+{
+	size_t sum{ 0 };
+	for (size_t i = 0; i < n; ++i)
+	{
+		co_await tp.schedule();
+		sum += i;
+	}
+	co_return sum;
+}
+
+// every task pushes the next one, the last one sets done
+static void pushNext(pool_t& tp, size_t left, std::atomic<bool>& done)
+{
+	if (left == 0)
+	{
+		done.store(true);
+		return;
+	}
+	std::function<size_t()> f{ [&tp, left, &done]() { pushNext(tp, left - 1, done); return left; } };
+	tp.push(f);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numHops = benchCommon::argOr(argc, argv, 1, 200000);
+
+	pool_t tp;
+	tp.start(2);
+
+	measure("push(std::function)+get", numHops / 10, [&](size_t n) {
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+		{
+			std::function<size_t()> f{ [i]() { return i; } };
+			sum += tp.push(f).get();
+		}
+		if (sum != n * (n - 1) / 2)
+			std::cout << "wrong sum" << std::endl;
+	});
+	measure("co_await schedule() caller", numHops / 10, [&](size_t n) {
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+			sum += concurency::sync_wait(once(tp, i));
+		if (sum != n * (n - 1) / 2)
+			std::cout << "wrong sum" << std::endl;
+	});
+	measure("push(std::function) chain", numHops, [&](size_t n) {
+		std::atomic<bool> done{ false };
+		pushNext(tp, n, done);
+		while (!done.load())
+			std::this_thread::yield();
+	});
+	measure("co_await schedule() chain", numHops, [&](size_t n) {
+		if (concurency::sync_wait(chain(tp, n)) != n * (n - 1) / 2)
+			std::cout << "wrong sum" << std::endl;
+	});
+	tp.end();
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "tp/threadpool.h"
+#include "tp/mapping.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <memory>
+
+/*
+	how much per key state locality survives a resize of the pool from n to n+1 and n to n-1.
+
+	stayed: share of the keys that are still mapped to the same worker, computed from the mapping alone.
+	warm:   a running pool, every key runs one task that remembers the thread that ran it,
+	        then the pool is resized and every key runs again, share of the keys that ran on the same thread.
+	ns/map: cost of mapping one key.
+
+	usage: bench_mapping [maxThreads] [numKeys]
+*/
+template<typename Mapping_t>
+static double stayed(size_t from, size_t to, size_t numKeys)
+{
+	size_t same{ 0 };
+	for (uint32_t key = 0; key < numKeys; ++key)
+		same += Mapping_t::map(key, from) == Mapping_t::map(key, to) ? 1 : 0;
+	return static_cast<double>(same) / static_cast<double>(numKeys);
+}
+
+template<typename Mapping_t>
+static double warm(size_t from, size_t to, size_t numKeys)
+{
+	concurency::threadPool<void, 128, concurency::threadsafe_queue, concurency::randomPlacement, Mapping_t> tp;
+	tp.start(from);
+
+	std::unique_ptr<std::thread::id[]> owner{ new std::thread::id[numKeys] };
+	std::atomic<size_t> same{ 0 };
+	std::vector<std::future<void>> futures;
+	for (uint32_t key = 0; key < numKeys; ++key)
+		futures.push_back(tp.push([&owner, key]() { owner[key] = std::this_thread::get_id(); }, key));
+	for (auto& f : futures)
+		f.get();
+
+	tp.resize(to);
+	futures.clear();
+	for (uint32_t key = 0; key < numKeys; ++key)
+		futures.push_back(tp.push([&owner, &same, key]() {
+			if (owner[key] == std::this_thread::get_id())
+				same.fetch_add(1, std::memory_order_relaxed);
+		}, key));
+	for (auto& f : futures)
+		f.get();
+	tp.end();
+	return static_cast<double>(same.load()) / static_cast<double>(numKeys);
+}
+
+template<typename Mapping_t>
+static double nsPerMap(size_t n, size_t numKeys)
+{
+	size_t sink{ 0 };
+	const auto begin = benchCommon::clock_t::now();
+	for (uint32_t key = 0; key < numKeys; ++key)
+		sink += Mapping_t::map(key, n);
+	const double ns = std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - begin).count();
+	if (sink == 1) // keeps the loop
+		std::cout << "";
+	return ns / static_cast<double>(numKeys);
+}
+
+template<typename Mapping_t>
+static void runAll(const std::string& name, size_t maxThreads, size_t numKeys)
+{
+	for (size_t n = 2; n <= maxThreads; ++n)
+	{
+		std::cout << std::left << std::setw(12) << name << std::right << " n: " << std::setw(3) << n
+			<< std::fixed << std::setprecision(3)
+			<< " stayed n+1: " << std::setw(6) << stayed<Mapping_t>(n, n + 1, numKeys)
+			<< " n-1: " << std::setw(6) << stayed<Mapping_t>(n, n - 1, numKeys)
+			<< " warm n+1: " << std::setw(6) << warm<Mapping_t>(n, n + 1, numKeys)
+			<< " n-1: " << std::setw(6) << warm<Mapping_t>(n, n - 1, numKeys)
+			<< std::setprecision(1) << " ns/map: " << std::setw(6) << nsPerMap<Mapping_t>(n, numKeys * 10)
+			<< std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t maxThreads = benchCommon::argOr(argc, argv, 1, 16);
+	const size_t numKeys = benchCommon::argOr(argc, argv, 2, 10000);
+
+	runAll<concurency::moduloMapping>("modulo", maxThreads, numKeys);
+	runAll<concurency::jumpHashMapping>("jump", maxThreads, numKeys);
+	runAll<concurency::rendezvousMapping>("rendezvous", maxThreads, numKeys);
+	return 0;
+}
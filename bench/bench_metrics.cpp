@@ -0,0 +1,55 @@
+#include "tp/threadpool.h"
+#include "tp/metrics.h"
+#include "bench_common.h"
+
+#include <atomic>
+
+/*
+	overhead of the instrumentation, the same empty tasks through pools that differ only in Metrics_t.
+	one producer posts to one worker (hashed), so the cost per task is not hidden by parallelism.
+	the difference in ns/task against noMetrics is what the metrics cost.
+
+	usage: bench_metrics [tasks] [rounds]
+*/
+template<typename Metrics_t>
+static double nsPerTask(size_t numTasks)
+{
+	concurency::threadPool<void, 128, concurency::mpsc_queue, concurency::randomPlacement, concurency::moduloMapping, Metrics_t> tp;
+	tp.start(1);
+
+	std::atomic<size_t> done{ 0 };
+	const auto begin = benchCommon::clock_t::now();
+	for (size_t i = 0; i < numTasks; ++i)
+		tp.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, 0);
+	while (done.load() != numTasks)
+		std::this_thread::yield();
+	const double ns = std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - begin).count();
+
+	if constexpr (Metrics_t::enabled)
+	{
+		const auto stats = tp.stats();
+		std::cout << "    executed: " << stats[0].executed << " timed: " << stats[0].run.count()
+			<< " wait p50 ns: " << stats[0].wait.percentile(50) << " p99 ns: " << stats[0].wait.percentile(99)
+			<< " run p50 ns: " << stats[0].run.percentile(50) << std::endl;
+	}
+	tp.end();
+	return ns / static_cast<double>(numTasks);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numTasks = benchCommon::argOr(argc, argv, 1, 1000000);
+	const size_t rounds = benchCommon::argOr(argc, argv, 2, 3);
+
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		const double none = nsPerTask<concurency::noMetrics>(numTasks);
+		const double sampled = nsPerTask<concurency::poolMetrics<16>>(numTasks);
+		const double every = nsPerTask<concurency::poolMetrics<1>>(numTasks);
+		std::cout << std::fixed << std::setprecision(1)
+			<< "noMetrics ns/task: " << std::setw(8) << none
+			<< " poolMetrics<16>: " << std::setw(8) << sampled << " (+" << sampled - none << ")"
+			<< " poolMetrics<1>: " << std::setw(8) << every << " (+" << every - none << ")" << std::endl;
+	}
+	return 0;
+}
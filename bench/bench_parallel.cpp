@@ -0,0 +1,143 @@
+#include "tp/threadpool.h"
+#include "tp/parallel.h"
+#include "bench_common.h"
+
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <functional>
+#if defined(TP_BENCH_STD_PAR)
+#include <execution>
+#endif
+
+/*
+	parallel algorithms of tp/parallel.h against serial STL, std::execution::par (when built with it, see CMakeLists.txt)
+	and the hand made way: one pushed task per fixed chunk and a future per chunk.
+
+	loop  - a[i] = f(i), the same cost for every i
+	skew  - the cost of i grows with i, fixed chunks leave the last worker with most of the work
+	reduce, transform_reduce, sort - over numItems values
+
+	usage: bench_parallel [numItems] [numThreads]
+*/
+
+typedef concurency::threadPool<void> pool_t;
+
+template<typename Func>
+static double timeMs(Func&& func)
+{
+	func(); // warm up
+	const auto begin = benchCommon::clock_t::now();
+	func();
+	return std::chrono::duration<double, std::milli>(benchCommon::clock_t::now() - begin).count();
+}
+
+static void print(const std::string& name, double serialMs, const std::string& variant, double ms)
+{
+	std::cout << std::left << std::setw(18) << name << std::setw(14) << variant << std::right << std::fixed << std::setprecision(2)
+		<< " ms: " << std::setw(10) << ms << " speedup: " << std::setw(6) << serialMs / ms << std::endl;
+}
+
+// the way it is done by hand, fixed chunks, one future each
+template<typename F>
+static void fixedChunks(pool_t& tp, size_t size, size_t numChunks, F&& func)
+{
+	std::vector<std::future<void>> futures;
+	for (size_t c = 0; c < numChunks; ++c)
+	{
+		const size_t begin = size * c / numChunks;
+		const size_t end = size * (c + 1) / numChunks;
+		futures.push_back(tp.push([begin, end, &func]() {
+			for (size_t i = begin; i < end; ++i)
+				func(i);
+		}));
+	}
+	for (auto& f : futures)
+		f.get();
+}
+
+static double work(size_t i, size_t rounds)
+{
+	double x = static_cast<double>(i);
+	for (size_t r = 0; r < rounds; ++r)
+		x = std::sqrt(x + static_cast<double>(r));
+	return x;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numItems = benchCommon::argOr(argc, argv, 1, 10000000);
+	const size_t numThreads = benchCommon::argOr(argc, argv, 2, std::max(2u, std::thread::hardware_concurrency()));
+
+	pool_t tp;
+	tp.start(numThreads);
+	std::cout << numItems << " items, " << numThreads << " workers + the caller" << std::endl;
+
+	std::vector<double> out(numItems);
+	{
+		auto f = [&out](size_t i) { out[i] = work(i, 4); };
+		const double serial = timeMs([&]() { for (size_t i = 0; i < numItems; ++i) f(i); });
+		print("loop", serial, "serial", serial);
+#if defined(TP_BENCH_STD_PAR)
+		std::vector<size_t> indices(numItems);
+		std::iota(indices.begin(), indices.end(), size_t{ 0 });
+		print("loop", serial, "std par", timeMs([&]() { std::for_each(std::execution::par, indices.begin(), indices.end(), f); }));
+#endif
+		print("loop", serial, "fixed chunks", timeMs([&]() { fixedChunks(tp, numItems, numThreads, f); }));
+		print("loop", serial, "parallel_for", timeMs([&]() { concurency::parallel_for(tp, size_t{ 0 }, numItems, f); }));
+	}
+	{
+		// the last items cost ~100 times the first ones
+		const size_t skewItems = numItems / 20;
+		auto f = [&out, skewItems](size_t i) { out[i] = work(i, 1 + i * 100 / skewItems); };
+		const double serial = timeMs([&]() { for (size_t i = 0; i < skewItems; ++i) f(i); });
+		print("skew", serial, "serial", serial);
+		print("skew", serial, "fixed chunks", timeMs([&]() { fixedChunks(tp, skewItems, numThreads, f); }));
+		print("skew", serial, "parallel_for", timeMs([&]() { concurency::parallel_for(tp, size_t{ 0 }, skewItems, f); }));
+	}
+
+	std::vector<uint64_t> values(numItems);
+	std::mt19937_64 rng{ 5 };
+	for (auto& v : values)
+		v = rng() % 1000000;
+	{
+		uint64_t res{ 0 };
+		const double serial = timeMs([&]() { res = std::accumulate(values.begin(), values.end(), uint64_t{ 0 }); });
+		print("reduce", serial, "serial", serial);
+#if defined(TP_BENCH_STD_PAR)
+		print("reduce", serial, "std par", timeMs([&]() { res = std::reduce(std::execution::par, values.begin(), values.end(), uint64_t{ 0 }); }));
+#endif
+		print("reduce", serial, "parallel", timeMs([&]() { res = concurency::parallel_reduce(tp, values.begin(), values.end(), uint64_t{ 0 }); }));
+		if (res != std::accumulate(values.begin(), values.end(), uint64_t{ 0 }))
+			std::cout << "wrong sum" << std::endl;
+	}
+	{
+		double res{ 0 };
+		auto transform = [](uint64_t v) { return std::sqrt(static_cast<double>(v)); };
+		const double serial = timeMs([&]() { res = std::transform_reduce(values.begin(), values.end(), 0.0, std::plus<>(), transform); });
+		print("transform_reduce", serial, "serial", serial);
+#if defined(TP_BENCH_STD_PAR)
+		print("transform_reduce", serial, "std par", timeMs([&]() { res = std::transform_reduce(std::execution::par, values.begin(), values.end(), 0.0, std::plus<>(), transform); }));
+#endif
+		print("transform_reduce", serial, "parallel", timeMs([&]() { res = concurency::parallel_transform_reduce(tp, values.begin(), values.end(), 0.0, std::plus<>(), transform); }));
+	}
+	{
+		std::vector<uint64_t> v;
+		auto sorted = [&](auto&& sort) {
+			return timeMs([&]() {
+				v = values;
+				sort();
+			});
+		};
+		const double serial = sorted([&]() { std::sort(v.begin(), v.end()); });
+		print("sort", serial, "serial", serial);
+#if defined(TP_BENCH_STD_PAR)
+		print("sort", serial, "std par", sorted([&]() { std::sort(std::execution::par, v.begin(), v.end()); }));
+#endif
+		print("sort", serial, "parallel", sorted([&]() { concurency::parallel_sort(tp, v.begin(), v.end()); }));
+		if (!std::is_sorted(v.begin(), v.end()))
+			std::cout << "not sorted" << std::endl;
+	}
+	tp.end();
+	return 0;
+}
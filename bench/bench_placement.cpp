@@ -0,0 +1,68 @@
+#include "tp/threadpool.h"
+#include "tp/placement.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <random>
+
+/*
+	placement policies for tasks pushed without a hash.
+	numProducers push tasks of uneven length (1..64 us),
+	throughput and push to completion latency per policy.
+
+	usage: bench_placement [numThreads] [numProducers] [tasksPerProducer]
+*/
+template<typename Placement_t>
+static void run(const std::string& name, size_t numThreads, size_t numProducers, size_t perProducer)
+{
+	using clock_t = benchCommon::clock_t;
+	concurency::threadPool<void, 128, concurency::threadsafe_queue, Placement_t> tp;
+
+	const size_t total = numProducers * perProducer;
+	std::vector<double> latenciesUs(total);
+	std::atomic<size_t> done{ 0 };
+
+	tp.start(numThreads);
+	const auto begin = clock_t::now();
+	std::vector<std::thread> producers;
+	for (size_t p = 0; p < numProducers; ++p)
+	{
+		producers.emplace_back([&, p]() {
+			std::mt19937 gen(static_cast<uint32_t>(p));
+			std::uniform_int_distribution<int> length(1, 64);
+			for (size_t i = 0; i < perProducer; ++i)
+			{
+				const size_t index = p * perProducer + i;
+				const auto pushed = clock_t::now();
+				const auto duration = std::chrono::microseconds(length(gen));
+				tp.post([&, index, pushed, duration]() {
+					benchCommon::spin(duration);
+					latenciesUs[index] = std::chrono::duration<double, std::micro>(clock_t::now() - pushed).count();
+					done.fetch_add(1);
+				});
+			}
+		});
+	}
+	for (auto& t : producers)
+		t.join();
+	while (done.load() != total)
+		std::this_thread::yield();
+	const double seconds = std::chrono::duration<double>(clock_t::now() - begin).count();
+	tp.end();
+
+	benchCommon::printLatency(name, latenciesUs, seconds);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numThreads = benchCommon::argOr(argc, argv, 1, std::max<size_t>(2, std::thread::hardware_concurrency()));
+	const size_t numProducers = benchCommon::argOr(argc, argv, 2, 4);
+	const size_t perProducer = benchCommon::argOr(argc, argv, 3, 5000);
+
+	std::cout << "threads: " << numThreads << " producers: " << numProducers << " tasks per producer: " << perProducer << std::endl;
+	run<concurency::randomPlacement>("random", numThreads, numProducers, perProducer);
+	run<concurency::roundRobinPlacement>("roundRobin", numThreads, numProducers, perProducer);
+	run<concurency::powerOfTwoPlacement>("powerOfTwo", numThreads, numProducers, perProducer);
+	run<concurency::leastLoadedPlacement>("leastLoaded", numThreads, numProducers, perProducer);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include "tp/threadpool.h"
+#include "tp/mpmc_queue.h"
+#include "tp/mpsc_queue.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <thread>
+
+/*
+	threadsafe_queue (mutex + deque) vs mpmc_queue (lock free ring) vs mpsc_queue (lock free list, one consumer)
+	1. the queues alone, numProducers push into one queue, numConsumers pop from it (one consumer for mpsc_queue)
+	2. threadPool with each queue type, numProducers push empty tasks like tests/test_common.h
+
+	usage: bench_queue [numProducers] [numConsumers] [itemsPerProducer]
+*/
+template<typename Queue_t>
+static void runQueue(const std::string& name, size_t numProducers, size_t numConsumers, size_t perProducer)
+{
+	Queue_t q;
+	const size_t total = numProducers * perProducer;
+	std::atomic<size_t> consumed{ 0 };
+
+	const auto begin = benchCommon::clock_t::now();
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < numProducers; ++p)
+	{
+		threads.emplace_back([&q, perProducer]() {
+			for (size_t i = 0; i < perProducer; ++i)
+				while (!q.try_push(size_t(i)))
+					std::this_thread::yield();
+		});
+	}
+	for (size_t c = 0; c < numConsumers; ++c)
+	{
+		threads.emplace_back([&q, &consumed, total]() {
+			size_t item{ 0 };
+			while (consumed.load(std::memory_order_relaxed) < total)
+			{
+				if (q.try_pop(item))
+					consumed.fetch_add(1, std::memory_order_relaxed);
+				else
+					std::this_thread::yield();
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	const double seconds = std::chrono::duration<double>(benchCommon::clock_t::now() - begin).count();
+
+	std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+		<< " items/s: " << std::setw(14) << static_cast<double>(total) / seconds << std::endl;
+}
+
+template<typename ThreadPool_t>
+static void runPool(const std::string& name, size_t numProducers, size_t numWorkers, size_t perProducer)
+{
+	ThreadPool_t tp;
+	tp.start(numWorkers);
+
+	const size_t total = numProducers * perProducer;
+	std::atomic<size_t> done{ 0 };
+
+	const auto begin = benchCommon::clock_t::now();
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < numProducers; ++p)
+	{
+		threads.emplace_back([&tp, &done, perProducer, p]() {
+			for (size_t i = 0; i < perProducer; ++i)
+				tp.push([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, static_cast<uint32_t>(p + i));
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	while (done.load() != total)
+		std::this_thread::yield();
+	const double seconds = std::chrono::duration<double>(benchCommon::clock_t::now() - begin).count();
+	tp.end();
+
+	std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+		<< " tasks/s: " << std::setw(14) << static_cast<double>(total) / seconds << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numProducers = benchCommon::argOr(argc, argv, 1, 10);
+	const size_t numConsumers = benchCommon::argOr(argc, argv, 2, std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+	const size_t perProducer = benchCommon::argOr(argc, argv, 3, 100000);
+
+	std::cout << "producers: " << numProducers << " consumers: " << numConsumers << " items per producer: " << perProducer << std::endl;
+
+	runQueue<concurency::threadsafe_queue<size_t>>("threadsafe_queue", numProducers, numConsumers, perProducer);
+	runQueue<concurency::mpmc_queue<size_t>>("mpmc_queue", numProducers, numConsumers, perProducer);
+	runQueue<concurency::threadsafe_queue<size_t>>("threadsafe_queue 1 cons", numProducers, 1, perProducer);
+	runQueue<concurency::mpsc_queue<size_t>>("mpsc_queue 1 cons", numProducers, 1, perProducer);
+
+	runPool<concurency::threadPool<void, 128, concurency::threadsafe_queue>>("pool threadsafe_queue", numProducers, numConsumers, perProducer);
+	runPool<concurency::threadPool<void, 128, concurency::mpmc_queue>>("pool mpmc_queue", numProducers, numConsumers, perProducer);
+	runPool<concurency::threadPool<void, 128, concurency::mpsc_queue>>("pool mpsc_queue", numProducers, numConsumers, perProducer);
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include "tp/threadpool.h"
+#include "bench_common.h"
+
+#include <atomic>
+
+/*
+	throughput from 1 to maxThreads cores, k producers feed k workers with empty tasks.
+	hashed: producer i pushes only to worker i, they share nothing but the pool object,
+	so the throughput should grow with k unless workers or pool fields share cache lines.
+	random: every producer pushes to all the workers.
+
+	usage: bench_scaling [maxThreads] [tasksPerProducer]
+*/
+template<typename ThreadPool_t>
+static double run(size_t k, size_t perProducer, bool hashed)
+{
+	ThreadPool_t tp;
+	tp.start(k);
+
+	const size_t total = k * perProducer;
+	std::atomic<size_t> done{ 0 };
+	std::atomic<bool> go{ false };
+
+	std::vector<std::thread> producers;
+	for (size_t p = 0; p < k; ++p)
+	{
+		producers.emplace_back([&, p]() {
+			while (!go.load())
+				std::this_thread::yield();
+			for (size_t i = 0; i < perProducer; ++i)
+			{
+				if (hashed)
+					tp.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, static_cast<uint32_t>(p));
+				else
+					tp.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+			}
+		});
+	}
+
+	const auto begin = benchCommon::clock_t::now();
+	go.store(true);
+	for (auto& t : producers)
+		t.join();
+	while (done.load() != total)
+		std::this_thread::yield();
+	const double seconds = std::chrono::duration<double>(benchCommon::clock_t::now() - begin).count();
+	tp.end();
+	return static_cast<double>(total) / seconds;
+}
+
+template<typename ThreadPool_t>
+static void runAll(const std::string& name, size_t maxThreads, size_t perProducer)
+{
+	for (size_t k = 1; k <= maxThreads; ++k)
+	{
+		const double hashed = run<ThreadPool_t>(k, perProducer, true);
+		const double random = run<ThreadPool_t>(k, perProducer, false);
+		std::cout << std::left << std::setw(20) << name << std::right << " threads: " << std::setw(3) << k
+			<< std::fixed << std::setprecision(1)
+			<< " hashed tasks/s: " << std::setw(14) << hashed
+			<< " random tasks/s: " << std::setw(14) << random << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t maxThreads = benchCommon::argOr(argc, argv, 1, std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+	const size_t perProducer = benchCommon::argOr(argc, argv, 2, 100000);
+
+	runAll<concurency::threadPool<void>>("threadsafe_queue", maxThreads, perProducer);
+	runAll<concurency::threadPool<void, 128, concurency::mpsc_queue>>("mpsc_queue", maxThreads, perProducer);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "tp/threadpool.h"
+#include "bench_common.h"
+
+#include <atomic>
+
+/*
+	skewed workload: most tasks are short, every 64th task is 100 times longer.
+	with random placement the short tasks queued behind a long one wait for it,
+	with work stealing an idle worker takes them.
+
+	usage: bench_stealing [numThreads] [numTasks]
+*/
+template<typename ThreadPool_t>
+static void run(ThreadPool_t& tp, const std::string& name, size_t numThreads, size_t numTasks)
+{
+	using clock_t = benchCommon::clock_t;
+
+	std::vector<clock_t::time_point> pushed(numTasks);
+	std::vector<double> latenciesUs(numTasks);
+	std::atomic<size_t> done{ 0 };
+
+	tp.start(numThreads);
+	const auto begin = clock_t::now();
+	for (size_t i = 0; i < numTasks; ++i)
+	{
+		pushed[i] = clock_t::now();
+		tp.push([&, i]() {
+			benchCommon::spin(std::chrono::microseconds(i % 64 == 0 ? 1000 : 10));
+			latenciesUs[i] = std::chrono::duration<double, std::micro>(clock_t::now() - pushed[i]).count();
+			done.fetch_add(1);
+		});
+	}
+	while (done.load() != numTasks)
+		std::this_thread::yield();
+	const double seconds = std::chrono::duration<double>(clock_t::now() - begin).count();
+	tp.end();
+
+	benchCommon::printLatency(name, latenciesUs, seconds);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numThreads = benchCommon::argOr(argc, argv, 1, std::max<size_t>(2, std::thread::hardware_concurrency()));
+	const size_t numTasks = benchCommon::argOr(argc, argv, 2, 20000);
+
+	std::cout << "threads: " << numThreads << " tasks: " << numTasks << std::endl;
+	{
+		concurency::threadPool<void> tp{ concurency::schedulingMode::random };
+		run(tp, "random", numThreads, numTasks);
+	}
+	{
+		concurency::threadPool<void> tp{ concurency::schedulingMode::workStealing };
+		run(tp, "workStealing", numThreads, numTasks);
+	}
+	return 0;
+}
@@ -0,0 +1,249 @@
+#include "tp/threadpool.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <functional>
+
+/*
+	the regression suite, every scenario in one run with machine readable output.
+	the flags follow google benchmark, so its tools (e.g. compare.py) read the json:
+
+	bench_suite [--benchmark_format=console|json|csv] [--benchmark_out=file] [--benchmark_out_format=json|csv]
+	            [--benchmark_filter=substring] [--max_threads=N] [--tasks=N]
+
+	throughput/producers:P/workers:W/hashed|random - empty posted tasks from P producers to W workers
+	fanout/workers:W                               - push_bulk of a batch, wait for all its futures, repeat
+	latency/workers:W                              - push to execute of paced tasks, the workers park between them
+	start_end/workers:W                            - start(W) followed by end() of an idle pool
+
+	P and W are 1, 2, 4 ... max_threads (default: the number of cpus, at least 2).
+	cmake --build . --target run_benchmarks writes bench_results.json in the build directory.
+*/
+typedef concurency::threadPool<void> pool_t;
+
+struct options
+{
+	benchReporter::format format{ benchReporter::format::console };
+	benchReporter::format outFormat{ benchReporter::format::json };
+	std::string out;
+	std::string filter;
+	size_t maxThreads{ std::max<size_t>(2, std::thread::hardware_concurrency()) };
+	size_t tasks{ 200000 };
+};
+
+static double elapsedNs(benchCommon::clock_t::time_point begin)
+{
+	return std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - begin).count();
+}
+
+static std::vector<size_t> powersUpTo(size_t max)
+{
+	std::vector<size_t> res;
+	for (size_t n = 1; n < max; n *= 2)
+		res.push_back(n);
+	res.push_back(max);
+	return res;
+}
+
+static benchResult throughput(size_t producers, size_t workers, bool hashed, size_t numTasks)
+{
+	pool_t tp;
+	tp.start(workers);
+
+	const size_t perProducer = numTasks / producers;
+	const size_t total = perProducer * producers;
+	std::atomic<size_t> done{ 0 };
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < producers; ++p)
+		threads.emplace_back([&, p]() {
+			while (!go.load())
+				std::this_thread::yield();
+			for (size_t i = 0; i < perProducer; ++i)
+			{
+				auto task = [&done]() { done.fetch_add(1, std::memory_order_relaxed); };
+				if (hashed)
+					tp.post(task, static_cast<uint32_t>(p * perProducer + i));
+				else
+					tp.post(task);
+			}
+		});
+
+	const auto begin = benchCommon::clock_t::now();
+	go.store(true);
+	for (auto& t : threads)
+		t.join();
+	while (done.load() != total)
+		std::this_thread::yield();
+	const double ns = elapsedNs(begin);
+	tp.end();
+
+	benchResult r;
+	r.name = "throughput/producers:" + std::to_string(producers) + "/workers:" + std::to_string(workers) + (hashed ? "/hashed" : "/random");
+	r.iterations = total;
+	r.realTimeNs = ns / static_cast<double>(total);
+	r.itemsPerSecond = static_cast<double>(total) * 1e9 / ns;
+	return r;
+}
+
+static benchResult fanout(size_t workers, size_t numTasks)
+{
+	pool_t tp;
+	tp.start(workers);
+
+	const size_t width{ 64 };
+	const size_t rounds = std::max<size_t>(1, numTasks / width);
+	std::atomic<size_t> sink{ 0 };
+	std::vector<std::function<void()>> batch(width, [&sink]() { sink.fetch_add(1, std::memory_order_relaxed); });
+
+	const auto begin = benchCommon::clock_t::now();
+	for (size_t i = 0; i < rounds; ++i)
+	{
+		auto futures = tp.push_bulk(batch.begin(), batch.end());
+		for (auto& f : futures)
+			f.get();
+	}
+	const double ns = elapsedNs(begin);
+	tp.end();
+
+	benchResult r;
+	r.name = "fanout/workers:" + std::to_string(workers);
+	r.iterations = rounds;
+	r.realTimeNs = ns / static_cast<double>(rounds);
+	r.itemsPerSecond = static_cast<double>(rounds * width) * 1e9 / ns;
+	r.counters.emplace_back("width", static_cast<double>(width));
+	return r;
+}
+
+static benchResult latency(size_t workers, size_t numTasks)
+{
+	pool_t tp;
+	tp.start(workers);
+
+	const size_t count = std::max<size_t>(1, numTasks / 20);
+	std::vector<double> samples(count);
+	std::atomic<size_t> done{ 0 };
+
+	const auto begin = benchCommon::clock_t::now();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto pushedAt = benchCommon::clock_t::now();
+		tp.post([&samples, &done, i, pushedAt]() {
+			samples[i] = std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - pushedAt).count();
+			done.fetch_add(1, std::memory_order_release);
+		});
+		benchCommon::spin(std::chrono::microseconds(20)); // paced, the workers go idle between tasks
+	}
+	while (done.load(std::memory_order_acquire) != count)
+		std::this_thread::yield();
+	const double ns = elapsedNs(begin);
+	tp.end();
+
+	benchResult r;
+	r.name = "latency/workers:" + std::to_string(workers);
+	r.iterations = count;
+	r.realTimeNs = benchCommon::percentile(samples, 50);
+	r.itemsPerSecond = static_cast<double>(count) * 1e9 / ns;
+	r.counters.emplace_back("p50_ns", benchCommon::percentile(samples, 50));
+	r.counters.emplace_back("p99_ns", benchCommon::percentile(samples, 99));
+	r.counters.emplace_back("p999_ns", benchCommon::percentile(samples, 99.9));
+	r.counters.emplace_back("max_ns", benchCommon::percentile(samples, 100));
+	return r;
+}
+
+static benchResult startEnd(size_t workers, size_t numTasks)
+{
+	pool_t tp;
+	const size_t cycles = std::max<size_t>(1, numTasks / 1000);
+	const auto begin = benchCommon::clock_t::now();
+	for (size_t i = 0; i < cycles; ++i)
+	{
+		tp.start(workers);
+		tp.end();
+	}
+	const double ns = elapsedNs(begin);
+
+	benchResult r;
+	r.name = "start_end/workers:" + std::to_string(workers);
+	r.iterations = cycles;
+	r.realTimeNs = ns / static_cast<double>(cycles);
+	return r;
+}
+
+static bool parseArgs(int argc, char* argv[], options& opts)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const size_t eq = arg.find('=');
+		const std::string name = arg.substr(0, eq);
+		const std::string value = eq == std::string::npos ? std::string{} : arg.substr(eq + 1);
+		if (name == "--benchmark_format" && benchReporter::parseFormat(value, opts.format))
+			continue;
+		if (name == "--benchmark_out_format" && benchReporter::parseFormat(value, opts.outFormat) && opts.outFormat != benchReporter::format::console)
+			continue;
+		if (name == "--benchmark_out" && !value.empty())
+			opts.out = value;
+		else if (name == "--benchmark_filter")
+			opts.filter = value;
+		else if (name == "--max_threads" && std::strtoull(value.c_str(), nullptr, 10) > 0)
+			opts.maxThreads = std::min<size_t>(pool_t{}.maxThreadNum(), std::strtoull(value.c_str(), nullptr, 10));
+		else if (name == "--tasks" && std::strtoull(value.c_str(), nullptr, 10) > 0)
+			opts.tasks = std::strtoull(value.c_str(), nullptr, 10);
+		else
+		{
+			std::cerr << "unknown argument: " << arg << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	options opts;
+	if (!parseArgs(argc, argv, opts))
+		return 1;
+
+	benchReporter reporter;
+	reporter.setFormat(opts.format);
+	benchReporter fileReporter;
+	fileReporter.setFormat(opts.outFormat);
+
+	auto run = [&](const std::string& name, const std::function<benchResult()>& bench) {
+		if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+			return;
+		benchResult r = bench();
+		if (!opts.out.empty())
+			fileReporter.add(r);
+		reporter.add(std::move(r));
+	};
+
+	const auto counts = powersUpTo(opts.maxThreads);
+	for (bool hashed : { false, true })
+		for (size_t producers : counts)
+			for (size_t workers : counts)
+			{
+				const std::string name = "throughput/producers:" + std::to_string(producers) + "/workers:" + std::to_string(workers) + (hashed ? "/hashed" : "/random");
+				run(name, [&]() { return throughput(producers, workers, hashed, opts.tasks); });
+			}
+	for (size_t workers : counts)
+		run("fanout/workers:" + std::to_string(workers), [&]() { return fanout(workers, opts.tasks); });
+	for (size_t workers : counts)
+		run("latency/workers:" + std::to_string(workers), [&]() { return latency(workers, opts.tasks); });
+	for (size_t workers : counts)
+		run("start_end/workers:" + std::to_string(workers), [&]() { return startEnd(workers, opts.tasks); });
+
+	reporter.finish(std::cout);
+	if (!opts.out.empty())
+	{
+		std::ofstream file(opts.out);
+		if (!file)
+		{
+			std::cerr << "can't write " << opts.out << std::endl;
+			return 1;
+		}
+		fileReporter.finish(file);
+	}
+	return 0;
+}
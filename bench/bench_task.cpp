@@ -0,0 +1,141 @@
+#include "tp/threadpool.h"
+#include "tp/unique_function.h"
+#include "tp/block_pool.h"
+#include "bench_common.h"
+
+#include <atomic>
+#include <cstdlib>
+
+/*
+	cost of wrapping a task, allocations per task and ns per task.
+
+	before: std::function + std::packaged_task, the way threadPool queued tasks before unique_function
+	after:  unique_function holding the callable and an std::promise from pool_allocator
+
+	both run in one thread through a threadsafe_queue so only the wrapping is measured,
+	then the whole threadPool round trip (push + get) with one worker, the same in a threadPool<anyResult>,
+	and post() that does not create a promise at all.
+
+	usage: bench_task [numTasks]
+*/
+
+static std::atomic<size_t> allocations{ 0 };
+
+// gcc sees free() of what the std library got from operator new once the replacements below are inlined, they match
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t align)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = benchCommon::alignedAlloc(size, static_cast<size_t>(align)))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { benchCommon::alignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { benchCommon::alignedFree(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+template<typename Func>
+static void measure(const std::string& name, size_t numTasks, Func&& func)
+{
+	func(numTasks / 10); // warm up caches and pools
+
+	const size_t before = allocations.load();
+	const auto begin = benchCommon::clock_t::now();
+	func(numTasks);
+	const double ns = std::chrono::duration<double, std::nano>(benchCommon::clock_t::now() - begin).count();
+	const size_t allocs = allocations.load() - before;
+
+	std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+		<< " allocs/task: " << std::setw(8) << static_cast<double>(allocs) / static_cast<double>(numTasks)
+		<< " ns/task: " << std::setw(10) << ns / static_cast<double>(numTasks) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numTasks = benchCommon::argOr(argc, argv, 1, 1000000);
+
+	// a typical small task, captures a few references
+	size_t a{ 1 }, b{ 2 }, c{ 3 };
+	auto task = [&a, &b, &c]() { return a + b + c; };
+
+	measure("before: function+packaged_task", numTasks, [&](size_t n) {
+		concurency::threadsafe_queue<std::packaged_task<size_t()>> q;
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+		{
+			std::function<size_t()> f{ task };
+			auto pt = std::packaged_task<size_t()>(f);
+			auto future = pt.get_future();
+			q.push_back(std::move(pt));
+			std::packaged_task<size_t()> out;
+			q.try_pop(out);
+			out();
+			sum += future.get();
+		}
+		if (sum != n * 6)
+			std::cout << "wrong sum" << std::endl;
+	});
+
+	measure("after: unique_function+promise", numTasks, [&](size_t n) {
+		concurency::threadsafe_queue<concurency::unique_function<void()>> q;
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+		{
+			std::promise<size_t> p{ std::allocator_arg, concurency::pool_allocator<size_t>() };
+			auto future = p.get_future();
+			q.push_back(concurency::unique_function<void()>{ [f = task, p = std::move(p)]() mutable { p.set_value(f()); } });
+			concurency::unique_function<void()> out;
+			q.try_pop(out);
+			out();
+			out = nullptr;
+			sum += future.get();
+		}
+		if (sum != n * 6)
+			std::cout << "wrong sum" << std::endl;
+	});
+
+	concurency::threadPool<size_t> tp;
+	tp.start(1);
+	measure("threadPool push+get, 1 worker", numTasks / 10, [&](size_t n) {
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+			sum += tp.push(task, 0).get();
+		if (sum != n * 6)
+			std::cout << "wrong sum" << std::endl;
+	});
+	measure("threadPool post, 1 worker", numTasks, [&](size_t n) {
+		std::atomic<size_t> done{ 0 };
+		for (size_t i = 0; i < n; ++i)
+			tp.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, 0);
+		while (done.load() != n)
+			std::this_thread::yield();
+	});
+	tp.end();
+
+	concurency::threadPool<concurency::anyResult> any;
+	any.start(1);
+	measure("threadPool<anyResult> push+get", numTasks / 10, [&](size_t n) {
+		size_t sum{ 0 };
+		for (size_t i = 0; i < n; ++i)
+			sum += any.push(task, 0).get();
+		if (sum != n * 6)
+			std::cout << "wrong sum" << std::endl;
+	});
+	any.end();
+	return 0;
+}
@@ -0,0 +1,54 @@
+#include "tp/threadpool.h"
+#include "bench_common.h"
+
+#include <atomic>
+
+/*
+	wake up latency per wait strategy: time from push to the start of the task.
+	tasks are pushed one by one with a pause in between, so the workers are idle
+	(spinning, yielding or parked) when a task arrives.
+
+	usage: bench_wait [numThreads] [numTasks] [pauseUs]
+*/
+template<template<typename> class Queue_t>
+static void run(const std::string& name, concurency::waitStrategy wait, size_t numThreads, size_t numTasks, size_t pauseUs)
+{
+	using clock_t = benchCommon::clock_t;
+	concurency::threadPool<void, 128, Queue_t> tp{ concurency::schedulingMode::random, wait };
+
+	std::vector<double> latenciesUs(numTasks);
+	std::atomic<size_t> done{ 0 };
+
+	tp.start(numThreads);
+	const auto begin = clock_t::now();
+	for (size_t i = 0; i < numTasks; ++i)
+	{
+		const auto pushed = clock_t::now();
+		tp.post([&latenciesUs, &done, i, pushed]() {
+			latenciesUs[i] = std::chrono::duration<double, std::micro>(clock_t::now() - pushed).count();
+			done.fetch_add(1);
+		});
+		benchCommon::spin(std::chrono::microseconds(pauseUs));
+	}
+	while (done.load() != numTasks)
+		std::this_thread::yield();
+	const double seconds = std::chrono::duration<double>(clock_t::now() - begin).count();
+	tp.end();
+
+	benchCommon::printLatency(name, latenciesUs, seconds);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numThreads = benchCommon::argOr(argc, argv, 1, std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+	const size_t numTasks = benchCommon::argOr(argc, argv, 2, 10000);
+	const size_t pauseUs = benchCommon::argOr(argc, argv, 3, 50);
+
+	std::cout << "threads: " << numThreads << " tasks: " << numTasks << " pause between pushes us: " << pauseUs << std::endl;
+	run<concurency::threadsafe_queue>("park", concurency::waitStrategy::park(), numThreads, numTasks, pauseUs);
+	run<concurency::threadsafe_queue>("yield 1000", concurency::waitStrategy{ 0, 1000 }, numThreads, numTasks, pauseUs);
+	run<concurency::threadsafe_queue>("spinThenPark", concurency::waitStrategy::spinThenPark(), numThreads, numTasks, pauseUs);
+	run<concurency::mpsc_queue>("spinThenPark mpsc", concurency::waitStrategy::spinThenPark(), numThreads, numTasks, pauseUs);
+	run<concurency::mpsc_queue>("spin 1M mpsc", concurency::waitStrategy{ 1000000, 0 }, numThreads, numTasks, pauseUs);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+
+typedef concurency::threadPool<concurency::anyResult> pool_t;
+
+// every push flavour gives a future of the return type of its task
+int testTypes(pool_t& tp)
+{
+	std::future<bool> b = tp.push([]() { return true; });
+	std::future<void> v = tp.push([]() {});
+	std::future<std::string> s = tp.push([]() { return std::string("abc"); }, 5);
+	std::future<std::unique_ptr<int>> u = tp.push([]() { return std::make_unique<int>(7); }, concurency::priority{ 0 });
+	std::future<std::shared_ptr<int>> sp = tp.push([]() { return std::make_shared<int>(8); }, 5, concurency::priority{ 0 });
+	std::future<double> d = tp.push_with_deadline([]() { return 1.5; }, std::chrono::steady_clock::now() + std::chrono::seconds(10));
+
+	if (!b.get())
+		return __LINE__;
+	v.get();
+	if (s.get() != "abc" || *u.get() != 7 || *sp.get() != 8 || d.get() != 1.5)
+		return __LINE__;
+
+	concurency::pool_future<int> p = tp.submit([]() { return 20; });
+	concurency::pool_future<std::string> next = std::move(p).then([](int x) { return std::to_string(x + 1); });
+	if (next.get() != "21")
+		return __LINE__;
+
+	std::vector<std::function<int()>> tasks;
+	for (int i = 0; i < 100; ++i)
+		tasks.push_back([i]() { return i; });
+	std::vector<std::future<int>> futures = tp.push_bulk(tasks.begin(), tasks.end());
+	for (int i = 0; i < 100; ++i)
+	{
+		if (futures[i].get() != i)
+			return __LINE__;
+	}
+
+	try
+	{
+		tp.push([]() -> long { throw std::runtime_error("fail"); }).get();
+		return __LINE__;
+	}
+	catch (std::runtime_error&) {}
+	return 0;
+}
+
+// tasks of different types run on the same workers and can wait for each other
+int testSharedWorkers(pool_t& tp, size_t numThreads)
+{
+	std::set<std::thread::id> tids;
+	std::mutex m;
+	auto record = [&tids, &m]() {
+		std::lock_guard<std::mutex> lock(m);
+		tids.insert(std::this_thread::get_id());
+	};
+
+	std::vector<std::future<void>> voids;
+	std::vector<std::future<bool>> bools;
+	for (int i = 0; i < 1000; ++i)
+	{
+		voids.push_back(tp.push([&record]() { record(); }));
+		bools.push_back(tp.push([&record]() { record(); return true; }));
+	}
+	for (auto& f : voids)
+		f.get();
+	for (auto& f : bools)
+	{
+		if (!f.get())
+			return __LINE__;
+	}
+	if (tids.size() > numThreads)
+		return __LINE__;
+
+	auto outer = tp.push([&tp]() {
+		auto inner = tp.push([]() { return std::string("inner"); });
+		return tp.get(inner).size();
+	});
+	if (outer.get() != 5)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	const size_t numThreads{ 4 };
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		pool_t tp{ mode };
+		tp.start(numThreads);
+		if (int res = testTypes(tp); res != 0)
+			return res;
+		if (int res = testSharedWorkers(tp, numThreads); res != 0)
+			return res;
+		tp.end();
+	}
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include "tp/threadpool.h"
+#include "tp/autoscaler.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/*
+	deterministic simulation of a pool, one sample per tick:
+	arrivals(tick) tasks come in, every worker runs serviceRate tasks per tick,
+	the time a worker has nothing to run counts as idle.
+*/
+struct simulation
+{
+	concurency::autoscaleController controller;
+	size_t threads;
+	size_t queued{ 0 };
+	size_t changes{ 0 };
+	size_t maxThreads{ 0 };
+	static constexpr size_t serviceRate = 10;
+
+	simulation(const concurency::autoscalePolicy& policy, size_t startThreads)
+		: controller(policy), threads(startThreads)
+	{}
+
+	void run(size_t ticks, const std::function<size_t(size_t)>& arrivals)
+	{
+		for (size_t t = 0; t < ticks; ++t)
+		{
+			const size_t capacity = threads * serviceRate;
+			const size_t ready = queued + arrivals(t);
+			const size_t served = std::min(ready, capacity);
+			queued = ready - served;
+			const double idle = 1.0 - static_cast<double>(served) / static_cast<double>(capacity);
+
+			const size_t next = controller.decide({ threads, queued, idle });
+			if (next != threads)
+				++changes;
+			threads = next;
+			maxThreads = std::max(maxThreads, threads);
+		}
+	}
+};
+
+concurency::autoscalePolicy simPolicy()
+{
+	concurency::autoscalePolicy policy;
+	policy.minThreads = 2;
+	policy.maxThreads = 16;
+	policy.growQueued = 4;
+	policy.shrinkIdle = 0.5;
+	policy.growAfter = 2;
+	policy.shrinkAfter = 10;
+	policy.cooldown = 3;
+	return policy;
+}
+
+int testBounds()
+{
+	try
+	{
+		concurency::autoscalePolicy bad;
+		bad.minThreads = 4;
+		bad.maxThreads = 2;
+		concurency::autoscaleController c{ bad };
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+
+	// below min grows at once, a flood never goes over max
+	simulation sim{ simPolicy(), 1 };
+	sim.run(1, [](size_t) { return 0; });
+	if (sim.threads != 2)
+		return __LINE__;
+	sim.run(500, [](size_t) { return 1000; });
+	if (sim.threads != 16 || sim.maxThreads != 16)
+	{
+		std::cout << "flood: " << sim.threads << " threads" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// a burst that needs 6 workers, then silence: grows to absorb it, drains, shrinks back to min
+int testBurst()
+{
+	simulation sim{ simPolicy(), 2 };
+	sim.run(50, [](size_t) { return 0; });
+	if (sim.threads != 2 || sim.changes != 0)
+		return __LINE__;
+
+	sim.run(300, [](size_t) { return 55; });
+	std::cout << "burst: " << sim.threads << " threads, " << sim.queued << " queued, " << sim.changes << " changes" << std::endl;
+	if (sim.threads < 6 || sim.queued > 4 * sim.threads)
+		return __LINE__;
+
+	sim.run(1000, [](size_t) { return 0; });
+	std::cout << "silence: " << sim.threads << " threads, " << sim.changes << " changes" << std::endl;
+	if (sim.threads != 2 || sim.queued != 0)
+		return __LINE__;
+	return 0;
+}
+
+// steady load: once settled the size does not change, a backlog or idleness of a single tick is ignored
+int testNoOscillation()
+{
+	simulation sim{ simPolicy(), 2 };
+	sim.run(200, [](size_t) { return 35; });
+	const size_t settled = sim.threads;
+	const size_t changes = sim.changes;
+	sim.run(2000, [](size_t t) {
+		if (t % 97 == 0)
+			return size_t{ 60 };	// a spike, absorbed in one tick
+		if (t % 89 == 0)
+			return size_t{ 0 };		// a dip
+		return size_t{ 35 };
+	});
+	std::cout << "steady: " << settled << " threads, " << sim.changes - changes << " changes after settling" << std::endl;
+	if (settled < 4 || sim.changes != changes || sim.threads != settled)
+		return __LINE__;
+	return 0;
+}
+
+// a real pool grows under a backlog of sleeping tasks and shrinks back to min when it is idle
+int testPool()
+{
+	concurency::threadPool<void, 8> tp;
+	tp.start(1);
+
+	concurency::autoscalePolicy policy;
+	policy.minThreads = 1;
+	policy.maxThreads = 8;
+	policy.growAfter = 1;
+	policy.shrinkAfter = 2;
+	policy.cooldown = 1;
+	policy.interval = std::chrono::milliseconds(10);
+	concurency::autoscaler<decltype(tp)> scaler{ tp, policy };
+
+	std::atomic<size_t> done{ 0 };
+	const size_t numTasks{ 400 };
+	for (size_t i = 0; i < numTasks; ++i)
+		tp.post([&done]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			done.fetch_add(1);
+		});
+
+	size_t maxThreads{ 0 };
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+	while (done.load() != numTasks && std::chrono::steady_clock::now() < deadline)
+	{
+		maxThreads = std::max(maxThreads, tp.threadNum());
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	while (tp.threadNum() != policy.minThreads && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	std::cout << "pool: grew to " << maxThreads << " threads, " << tp.threadNum() << " after the backlog" << std::endl;
+	if (done.load() != numTasks || maxThreads < 2 || tp.threadNum() != policy.minThreads)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testBounds(); res != 0)
+		return res;
+	if (int res = testBurst(); res != 0)
+		return res;
+	if (int res = testNoOscillation(); res != 0)
+		return res;
+	if (int res = testPool(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,191 @@
+#include "tp/threadpool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+// read from a stream, push_bulk sees a single pass input iterator
+struct readTask
+{
+	size_t value{ 0 };
+	size_t operator()()const { return value; }
+};
+std::istream& operator>>(std::istream& in, readTask& t) { return in >> t.value; }
+
+int testPushBulk(size_t numThreads)
+{
+	concurency::threadPool<size_t> tp;
+	tp.start(numThreads);
+
+	std::vector<std::function<size_t()>> tasks;
+	for (size_t i = 0; i < 1000; ++i)
+		tasks.push_back([i]() { return i; });
+
+	auto futures = tp.push_bulk(tasks.begin(), tasks.end());
+	if (futures.size() != tasks.size())
+		return __LINE__;
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		if (futures[i].get() != i)
+		{
+			std::cout << "future " << i << " has a wrong value" << std::endl;
+			return __LINE__;
+		}
+	}
+
+	// less tasks than workers
+	auto few = tp.push_bulk(tasks.begin(), tasks.begin() + 1);
+	if (few.size() != 1 || few[0].get() != 0)
+		return __LINE__;
+
+	// empty range
+	if (!tp.push_bulk(tasks.begin(), tasks.begin()).empty())
+		return __LINE__;
+
+	tp.end();
+	return 0;
+}
+
+// tasks with the same key keep their order
+int testHashedBulk(size_t numThreads)
+{
+	concurency::threadPool<void> tp;
+	tp.start(numThreads);
+
+	const size_t numKeys{ 7 };
+	const size_t perKey{ 200 };
+	std::vector<size_t> next(numKeys, 0);
+	std::atomic<bool> failed{ false };
+
+	struct keyedTask
+	{
+		size_t key;
+		size_t seq;
+		std::vector<size_t>* next;
+		std::atomic<bool>* failed;
+		void operator()()const
+		{
+			if ((*next)[key] != seq)
+				failed->store(true);
+			++(*next)[key];
+		}
+	};
+
+	std::vector<keyedTask> tasks;
+	for (size_t i = 0; i < perKey; ++i)
+		for (size_t k = 0; k < numKeys; ++k)
+			tasks.push_back(keyedTask{ k, i, &next, &failed });
+
+	auto futures = tp.push_bulk(tasks.begin(), tasks.end(), [](const keyedTask& t) { return static_cast<uint32_t>(t.key); });
+	for (auto& f : futures)
+		f.get();
+	tp.post_bulk(tasks.begin(), tasks.begin(), [](const keyedTask& t) { return static_cast<uint32_t>(t.key); });
+	tp.end();
+
+	if (failed.load())
+	{
+		std::cout << "tasks with the same hash were reordered" << std::endl;
+		return __LINE__;
+	}
+	for (size_t k = 0; k < numKeys; ++k)
+		if (next[k] != perKey)
+			return __LINE__;
+	return 0;
+}
+
+int testPostBulk(concurency::schedulingMode mode, size_t numThreads)
+{
+	concurency::threadPool<bool> tp{ mode };
+	tp.start(numThreads);
+
+	std::atomic<size_t> cnt{ 0 };
+	std::vector<std::unique_ptr<size_t>> values;
+	std::vector<std::function<void()>> copyable;
+	for (size_t i = 0; i < 1000; ++i)
+		copyable.push_back([&cnt]() { ++cnt; });
+
+	// move only callables through a move iterator
+	auto moveOnly = [&cnt, p = std::make_unique<size_t>(1)]() { cnt += *p; };
+	std::vector<decltype(moveOnly)> moveOnlyTasks;
+	moveOnlyTasks.push_back(std::move(moveOnly));
+
+	tp.post_bulk(copyable.begin(), copyable.end());
+	tp.post_bulk(copyable.begin(), copyable.end(), [](const std::function<void()>&) { return 5u; });
+	tp.post_bulk(std::make_move_iterator(moveOnlyTasks.begin()), std::make_move_iterator(moveOnlyTasks.end()));
+	tp.end();
+
+	if (cnt.load() != 2001)
+	{
+		std::cout << "expected 2001 executed tasks, got " << cnt.load() << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// the range can be walked only once, every task still gets a valid future
+int testInputIterator(size_t numThreads)
+{
+	concurency::threadPool<size_t> tp;
+	tp.start(numThreads);
+
+	std::string text;
+	for (size_t i = 0; i < 100; ++i)
+		text += std::to_string(i) + " ";
+
+	std::istringstream in{ text };
+	auto futures = tp.push_bulk(std::istream_iterator<readTask>{ in }, std::istream_iterator<readTask>{});
+	if (futures.size() != 100)
+		return __LINE__;
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		if (!futures[i].valid() || futures[i].get() != i)
+			return __LINE__;
+	}
+
+	std::istringstream hashedIn{ text };
+	futures = tp.push_bulk(std::istream_iterator<readTask>{ hashedIn }, std::istream_iterator<readTask>{}, [](const readTask& t) { return t.value % 3; });
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		if (futures[i].get() != i)
+			return __LINE__;
+	}
+	if (futures.size() != 100)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	concurency::threadPool<void> tp;
+	std::vector<std::function<void()>> tasks(3, []() {});
+	try
+	{
+		tp.post_bulk(tasks.begin(), tasks.end());
+		std::cout << "should have caugth expected std::logic_error" << std::endl;
+		return __LINE__;
+	}
+	catch (std::logic_error& ex)
+	{
+		std::cout << "caugth expected std::logic_error: " << ex.what() << std::endl;
+	}
+
+	for (size_t n : {1, 2, 3, 5})
+	{
+		if (int res = testPushBulk(n))
+			return res;
+		if (int res = testHashedBulk(n))
+			return res;
+		if (int res = testPostBulk(concurency::schedulingMode::random, n))
+			return res;
+		if (int res = testPostBulk(concurency::schedulingMode::workStealing, n))
+			return res;
+		if (int res = testInputIterator(n))
+			return res;
+	}
+	return 0;
+}
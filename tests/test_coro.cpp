@@ -0,0 +1,181 @@
+#include "tp/coro.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+typedef concurency::threadPool<void> pool_t;
+
+concurency::task<std::thread::id> where(pool_t& tp)
+{
+	co_await tp.schedule();
+	co_return std::this_thread::get_id();
+}
+
+// schedule() leaves the calling thread
+int testSchedule()
+{
+	pool_t tp;
+	tp.start(2);
+	if (concurency::sync_wait(where(tp)) == std::this_thread::get_id())
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+concurency::task<std::thread::id> workerOf(pool_t& tp, uint32_t hash)
+{
+	co_await tp.schedule_on(hash);
+	co_return std::this_thread::get_id();
+}
+
+concurency::task<size_t> hops(pool_t& tp, uint32_t numKeys, size_t rounds)
+{
+	std::vector<std::thread::id> first(numKeys);
+	size_t wrong{ 0 };
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		for (uint32_t k = 0; k < numKeys; ++k)
+		{
+			const std::thread::id id = co_await workerOf(tp, k);
+			if (r == 0)
+				first[k] = id;
+			else if (first[k] != id)
+				++wrong;
+		}
+	}
+	co_return wrong;
+}
+
+// schedule_on(hash) resumes on the worker of hash every time
+int testScheduleOn()
+{
+	pool_t tp;
+	tp.start(4);
+	if (concurency::sync_wait(hops(tp, 16, 50)) != 0)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+concurency::task<int> leaf(pool_t& tp, int v)
+{
+	co_await tp.schedule();
+	if (v < 0)
+		throw std::invalid_argument("negative");
+	co_return v * 2;
+}
+
+concurency::task<int> sum(pool_t& tp, int n)
+{
+	int res{ 0 };
+	for (int i = 0; i < n; ++i)
+		res += co_await leaf(tp, i);
+	co_return res;
+}
+
+concurency::task<int> failing(pool_t& tp)
+{
+	const int a = co_await leaf(tp, 1);
+	const int b = co_await leaf(tp, -1);
+	co_return a + b;
+}
+
+concurency::task<> nothing(pool_t& tp, std::atomic<int>& ran)
+{
+	co_await tp.schedule();
+	ran.fetch_add(1);
+}
+
+// nested tasks pass values and exceptions up
+int testNested()
+{
+	pool_t tp;
+	tp.start(3);
+	if (concurency::sync_wait(sum(tp, 100)) != 9900)
+		return __LINE__;
+	try
+	{
+		concurency::sync_wait(failing(tp));
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+
+	std::atomic<int> ran{ 0 };
+	concurency::sync_wait(nothing(tp, ran));
+	if (ran.load() != 1)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+concurency::task<size_t> depth(size_t n)
+{
+	if (n == 0)
+		co_return 0;
+	co_return 1 + co_await depth(n - 1);
+}
+
+// a deep chain of awaits doesn't grow the stack, frames come from block_pool
+int testDeep()
+{
+	if (concurency::sync_wait(depth(10000)) != 10000)
+		return __LINE__;
+	return 0;
+}
+
+// many threads wait for many coroutines that hop between the workers
+int testLoad()
+{
+	pool_t tp{ concurency::schedulingMode::workStealing };
+	tp.start(4);
+
+	std::atomic<size_t> wrong{ 0 };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+		threads.emplace_back([&tp, &wrong]() {
+			for (int i = 0; i < 50; ++i)
+			{
+				if (concurency::sync_wait(sum(tp, 100)) != 9900)
+					wrong.fetch_add(1);
+			}
+		});
+	for (auto& t : threads)
+		t.join();
+	tp.end();
+	if (wrong.load() != 0)
+		return __LINE__;
+	return 0;
+}
+
+// co_await on a pool that is not running throws
+int testNotRunning()
+{
+	pool_t tp;
+	try
+	{
+		concurency::sync_wait(where(tp));
+		return __LINE__;
+	}
+	catch (std::logic_error&) {}
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testSchedule(); res != 0)
+		return res;
+	if (int res = testScheduleOn(); res != 0)
+		return res;
+	if (int res = testNested(); res != 0)
+		return res;
+	if (int res = testDeep(); res != 0)
+		return res;
+	if (int res = testLoad(); res != 0)
+		return res;
+	if (int res = testNotRunning(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,178 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+// the only worker is busy until gate is set
+template<typename Pool_t>
+void block(Pool_t& tp, std::atomic<bool>& gate)
+{
+	std::atomic<bool> running{ false };
+	tp.post([&gate, &running]() {
+		running.store(true);
+		while (!gate.load())
+			std::this_thread::yield();
+	});
+	while (!running.load())
+		std::this_thread::yield();
+}
+
+// queued in the reverse order of their deadlines, they run by deadline and before the tasks without one
+int testOrder(concurency::schedulingMode mode)
+{
+	concurency::threadPool<int> tp{ mode };
+	tp.start(1);
+	std::atomic<bool> gate{ false };
+	block(tp, gate);
+
+	std::vector<int> order;	// written only by the worker
+	tp.post([&order]() { order.push_back(-1); });
+	const auto now = std::chrono::steady_clock::now();
+	std::vector<std::future<int>> futures;
+	for (int i = 9; i >= 0; --i)
+		futures.push_back(tp.push_with_deadline([&order, i]() { order.push_back(i); return i; }, now + 10s + i * 1ms));
+	tp.post_with_deadline([&order]() { order.push_back(100); }, now + 20s);
+	gate.store(true);
+
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		if (futures[i].get() != static_cast<int>(9 - i))
+			return __LINE__;
+	}
+	tp.end();
+
+	const std::vector<int> expected{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 100, -1 };
+	if (order != expected)
+		return __LINE__;
+	if (tp.missedDeadlines() != 0)
+		return __LINE__;
+	return 0;
+}
+
+// late tasks are not called, their futures throw deadlineMissed, all of them are counted
+int testMissed()
+{
+	concurency::threadPool<int, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::poolMetrics<1>> tp;
+	tp.start(1);
+	std::atomic<bool> gate{ false };
+	block(tp, gate);
+
+	std::atomic<size_t> called{ 0 };
+	const auto now = std::chrono::steady_clock::now();
+	std::vector<std::future<int>> late, inTime;
+	for (int i = 0; i < 10; ++i)
+	{
+		late.push_back(tp.push_with_deadline([&called]() { called.fetch_add(1); return 1; }, now + 5ms));
+		inTime.push_back(tp.push_with_deadline([&called]() { called.fetch_add(1); return 2; }, now + 60s));
+		tp.post_with_deadline([&called]() { called.fetch_add(1); }, now + 5ms);
+	}
+	// already late when pushed, never queued
+	auto gone = tp.push_with_deadline([&called]() { called.fetch_add(1); return 3; }, now - 1ms);
+	tp.post_with_deadline([&called]() { called.fetch_add(1); }, now - 1ms);
+
+	std::this_thread::sleep_for(20ms);
+	gate.store(true);
+
+	for (auto& f : inTime)
+	{
+		if (f.get() != 2)
+			return __LINE__;
+	}
+	for (auto& f : late)
+	{
+		try
+		{
+			f.get();
+			return __LINE__;
+		}
+		catch (concurency::deadlineMissed&) {}
+	}
+	try
+	{
+		gone.get();
+		return __LINE__;
+	}
+	catch (concurency::deadlineMissed&) {}
+	std::this_thread::sleep_for(20ms); // the posted ones
+
+	// late when a worker pushes it, counted by that worker too
+	tp.push([&tp, now]() {
+		tp.post_with_deadline([]() {}, now - 1ms);
+		return 0;
+	}).get();
+
+	concurency::workerStats total;
+	for (const auto& s : tp.stats())
+		total.merge(s);
+	tp.end();
+
+	std::cout << "called " << called.load() << " missed " << tp.missedDeadlines() << " missed on workers " << total.missed << std::endl;
+	if (called.load() != 10 || tp.missedDeadlines() != 23 || total.missed != 21)
+		return __LINE__;
+
+	// not running, late or not
+	for (auto deadline : { now - 1ms, now + 60s })
+	{
+		try
+		{
+			tp.push_with_deadline([]() { return 1; }, deadline);
+			return __LINE__;
+		}
+		catch (std::logic_error&) {}
+		try
+		{
+			tp.post_with_deadline([]() {}, deadline);
+			return __LINE__;
+		}
+		catch (std::logic_error&) {}
+	}
+	return 0;
+}
+
+// many producers, every task has a deadline far away, all of them run
+int testLoad(concurency::schedulingMode mode)
+{
+	concurency::threadPool<void> tp{ mode };
+	tp.start(4);
+
+	std::atomic<size_t> done{ 0 };
+	const size_t perProducer{ 20000 };
+	std::vector<std::thread> producers;
+	for (size_t p = 0; p < 3; ++p)
+		producers.emplace_back([&tp, &done, p]() {
+			for (size_t i = 0; i < perProducer; ++i)
+			{
+				const auto deadline = std::chrono::steady_clock::now() + 60s + std::chrono::microseconds((i * 7 + p) % 1000);
+				if (i % 2 == 0)
+					tp.post_with_deadline([&done]() { done.fetch_add(1); }, deadline);
+				else
+					tp.post([&done]() { done.fetch_add(1); });
+			}
+		});
+	for (auto& t : producers)
+		t.join();
+	tp.end();
+
+	if (done.load() != 3 * perProducer || tp.missedDeadlines() != 0)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		if (int res = testOrder(mode); res != 0)
+			return res;
+		if (int res = testLoad(mode); res != 0)
+			return res;
+	}
+	if (int res = testMissed(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+// a task of a single worker pool waits for tasks it pushed, the worker runs them meanwhile
+int testSingleWorker()
+{
+	concurency::threadPool<int> tp;
+	tp.start(1);
+
+	auto outer = tp.push([&tp]() {
+		std::vector<std::future<int>> futures;
+		for (int i = 0; i < 10; ++i)
+			futures.push_back(tp.push([i]() { return i; }));
+		int sum{ 0 };
+		for (auto& f : futures)
+			sum += tp.get(f);
+
+		auto p = tp.submit([]() { return 100; });
+		return sum + tp.get(p);
+	});
+	if (outer.wait_for(10s) != std::future_status::ready || outer.get() != 145)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+// recursive fork/join, more waiting tasks than workers
+int fib(concurency::threadPool<int>& tp, int n)
+{
+	if (n < 2)
+		return n;
+	auto left = tp.push([&tp, n]() { return fib(tp, n - 1); });
+	const int right = fib(tp, n - 2);
+	return tp.get(left) + right;
+}
+
+int testNested(concurency::schedulingMode mode)
+{
+	concurency::threadPool<int> tp{ mode };
+	tp.start(2);
+	auto f = tp.push([&tp]() { return fib(tp, 15); });
+	if (f.wait_for(30s) != std::future_status::ready || f.get() != 610)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+/*
+	a hashed task waits for an unhashed one, the later tasks of its key queued on the same worker
+	don't run while it waits, they keep their order.
+*/
+int testKeyOrder()
+{
+	concurency::threadPool<void> tp;
+	tp.start(1);
+
+	std::vector<int> order;	// written only by the worker
+	std::atomic<bool> pushed{ false };
+	const uint32_t key{ 7 };
+	tp.post([&]() {
+		while (!pushed.load())
+			std::this_thread::yield();
+		auto sub = tp.push([&order]() { order.push_back(100); });
+		tp.get(sub);
+		order.push_back(0);
+	}, key);
+	for (int i = 1; i <= 5; ++i)
+		tp.post([&order, i]() { order.push_back(i); }, key);
+	pushed.store(true);
+
+	auto last = tp.push([]() {}, key);
+	last.get();
+	tp.end();
+
+	const std::vector<int> expected{ 100, 0, 1, 2, 3, 4, 5 };
+	if (order != expected)
+		return __LINE__;
+	return 0;
+}
+
+// a thread that is not a worker just waits
+int testOutside()
+{
+	concurency::threadPool<int> tp;
+	tp.start(2);
+	auto f = tp.push([]() { std::this_thread::sleep_for(5ms); return 3; });
+	if (tp.get(f) != 3)
+		return __LINE__;
+	std::shared_future<int> s = tp.push([]() { return 4; }).share();
+	if (tp.get(s) != 4)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testSingleWorker(); res != 0)
+		return res;
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		if (int res = testNested(mode); res != 0)
+			return res;
+	}
+	if (int res = testKeyOrder(); res != 0)
+		return res;
+	if (int res = testOutside(); res != 0)
+		return res;
+	return 0;
+}
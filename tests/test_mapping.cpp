@@ -0,0 +1,135 @@
+#include "tp/threadpool.h"
+#include "tp/mapping.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// every key maps into range, the same key always maps to the same worker, keys are spread evenly
+template<typename Mapping_t>
+int testRangeAndBalance(const char* name)
+{
+	const size_t numKeys{ 100000 };
+	for (size_t n = 1; n <= 16; ++n)
+	{
+		std::vector<size_t> counts(n, 0);
+		for (uint32_t key = 0; key < numKeys; ++key)
+		{
+			const size_t w = Mapping_t::map(key, n);
+			if (w >= n || w != Mapping_t::map(key, n))
+			{
+				std::cout << name << ": bad worker " << w << " of " << n << std::endl;
+				return __LINE__;
+			}
+			++counts[w];
+		}
+		const size_t expected = numKeys / n;
+		for (size_t c : counts)
+		{
+			if (c < expected * 8 / 10 || c > expected * 12 / 10)
+			{
+				std::cout << name << ": " << c << " keys on a worker, expected about " << expected << std::endl;
+				return __LINE__;
+			}
+		}
+	}
+	return 0;
+}
+
+// n -> n+1 moves keys only to the new worker, n -> n-1 moves only the keys of the last worker
+template<typename Mapping_t>
+int testMinimalMovement(const char* name)
+{
+	const size_t numKeys{ 100000 };
+	for (size_t n = 1; n < 32; ++n)
+	{
+		size_t moved{ 0 };
+		for (uint32_t key = 0; key < numKeys; ++key)
+		{
+			const size_t before = Mapping_t::map(key, n);
+			const size_t after = Mapping_t::map(key, n + 1);
+			if (before != after)
+			{
+				++moved;
+				if (after != n)
+				{
+					std::cout << name << ": key moved from " << before << " to " << after << " growing to " << n + 1 << std::endl;
+					return __LINE__;
+				}
+			}
+		}
+		// about 1/(n+1) of the keys move
+		const size_t expected = numKeys / (n + 1);
+		if (moved < expected * 8 / 10 || moved > expected * 12 / 10)
+		{
+			std::cout << name << ": " << moved << " keys moved growing to " << n + 1 << ", expected about " << expected << std::endl;
+			return __LINE__;
+		}
+	}
+	return 0;
+}
+
+// the order per key survives resizes, with a consistent mapping a shrink waits only for the retired workers
+template<typename Mapping_t>
+int testPoolOrder()
+{
+	concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, Mapping_t> tp;
+	tp.start(4);
+
+	const size_t numKeys{ 128 };
+	std::unique_ptr<std::atomic<size_t>[]> last{ new std::atomic<size_t>[numKeys] };
+	for (size_t k = 0; k < numKeys; ++k)
+		last[k].store(0);
+	std::atomic<size_t> errors{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::thread resizer{ [&]() {
+		const size_t sizes[] = { 5, 3, 8, 1, 6, 2, 7, 4 };
+		for (size_t i = 0; !done.load(); ++i)
+			tp.resize(sizes[i % std::size(sizes)]);
+	} };
+
+	std::vector<size_t> seq(numKeys, 0);
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		const size_t key = i % numKeys;
+		const size_t s = ++seq[key];
+		tp.post([&, key, s]() {
+			if (last[key].exchange(s) != s - 1)
+				errors.fetch_add(1);
+		}, static_cast<uint32_t>(key));
+		if (i % 100 == 0)
+			std::this_thread::yield();
+	}
+	done.store(true);
+	resizer.join();
+	tp.end();
+
+	if (errors.load() != 0)
+	{
+		std::cout << errors.load() << " tasks out of order" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testRangeAndBalance<concurency::moduloMapping>("modulo"); res != 0)
+		return res;
+	if (int res = testRangeAndBalance<concurency::jumpHashMapping>("jump"); res != 0)
+		return res;
+	if (int res = testRangeAndBalance<concurency::rendezvousMapping>("rendezvous"); res != 0)
+		return res;
+	if (int res = testMinimalMovement<concurency::jumpHashMapping>("jump"); res != 0)
+		return res;
+	if (int res = testMinimalMovement<concurency::rendezvousMapping>("rendezvous"); res != 0)
+		return res;
+	if (int res = testPoolOrder<concurency::jumpHashMapping>(); res != 0)
+		return res;
+	if (int res = testPoolOrder<concurency::rendezvousMapping>(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include "tp/threadpool.h"
+#include "tp/metrics.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// every value lands in a bucket whose highest value is within 12.5% above it
+int testHistogram()
+{
+	using h_t = concurency::histogramSnapshot;
+	for (uint64_t v : { 0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 100ull, 1000ull, 123456789ull, ~0ull >> 1, ~0ull })
+	{
+		const size_t b = h_t::bucketOf(v);
+		const uint64_t high = h_t::highestOf(b);
+		if (b >= h_t::numBuckets || high < v || static_cast<double>(high - v) > static_cast<double>(v) / 8.0)
+		{
+			std::cout << "value " << v << " bucket " << b << " highest " << high << std::endl;
+			return __LINE__;
+		}
+	}
+	// buckets are ordered
+	for (size_t b = 1; b < h_t::numBuckets; ++b)
+		if (h_t::highestOf(b) <= h_t::highestOf(b - 1))
+			return __LINE__;
+
+	concurency::latencyHistogram h;
+	for (uint64_t v = 1; v <= 1000; ++v)
+		h.record(v * 1000);
+	const auto s = h.snapshot();
+	if (s.count() != 1000)
+		return __LINE__;
+	const uint64_t p50 = s.percentile(50);
+	const uint64_t p99 = s.percentile(99);
+	if (p50 < 500000 || p50 > 500000 * 9 / 8 || p99 < 990000 || p99 > 990000 * 9 / 8 || s.percentile(100) < 1000000)
+	{
+		std::cout << "p50 " << p50 << " p99 " << p99 << std::endl;
+		return __LINE__;
+	}
+	if (concurency::histogramSnapshot{}.percentile(50) != 0)
+		return __LINE__;
+	return 0;
+}
+
+// counters and histograms of every task, the sleeping ones show up in the run histogram
+int testPoolStats(concurency::schedulingMode mode)
+{
+	concurency::threadPool<int, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::poolMetrics<1>> tp{ mode };
+	tp.start(4);
+
+	const size_t numTasks{ 1000 };
+	std::vector<std::future<int>> futures;
+	for (size_t i = 0; i < numTasks; ++i)
+	{
+		if (i % 100 == 0)
+			futures.push_back(tp.push([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); return 1; }));
+		else if (i % 2 == 0)
+			futures.push_back(tp.push([]() { return 1; }, static_cast<uint32_t>(i)));
+		else
+			tp.post([]() {});
+	}
+	for (auto& f : futures)
+		f.get();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50)); // posted tasks finish, workers park
+
+	const auto stats = tp.stats();
+	if (stats.size() != 4)
+		return __LINE__;
+	concurency::workerStats total;
+	for (const auto& s : stats)
+		total.merge(s);
+	tp.end();
+
+	std::cout << "executed " << total.executed << " stolen " << total.stolen << " parked " << total.parked
+		<< " wait p50 " << total.wait.percentile(50) << " ns, run p50 " << total.run.percentile(50)
+		<< " ns p99.9 " << total.run.percentile(99.9) << " ns" << std::endl;
+	if (total.executed != numTasks || total.wait.count() != numTasks || total.run.count() != numTasks)
+		return __LINE__;
+	if (total.parked == 0 || total.queued != 0)
+		return __LINE__;
+	if (mode == concurency::schedulingMode::random && total.stolen != 0)
+		return __LINE__;
+	// 10 tasks slept 2ms
+	if (total.run.percentile(99.9) < 2000000 || total.run.percentile(50) >= 2000000)
+		return __LINE__;
+	return 0;
+}
+
+// with timeEvery = 4 one push in four is timed, all are counted
+int testSampling()
+{
+	concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::poolMetrics<4>> tp;
+	tp.start(2);
+	std::vector<std::future<void>> futures;
+	for (size_t i = 0; i < 400; ++i)
+		futures.push_back(tp.push([]() {}));
+	for (auto& f : futures)
+		f.get();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50)); // a task is timed after its future is ready
+
+	concurency::workerStats total;
+	for (const auto& s : tp.stats())
+		total.merge(s);
+	tp.end();
+
+	if (total.executed != 400 || total.run.count() != 100)
+	{
+		std::cout << "executed " << total.executed << " timed " << total.run.count() << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+/*
+	two pools of the same type share the thread local of their Metrics_t,
+	a late push from a worker of a to b is counted by b, not by the counters of the worker of a.
+*/
+int testTwoPools()
+{
+	typedef concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::poolMetrics<1>> pool_t;
+	pool_t a, b;
+	a.start(1);
+	b.start(1);
+
+	const auto late = std::chrono::steady_clock::now() - std::chrono::milliseconds(1);
+	a.push([&a, &b, late]() {
+		b.post_with_deadline([]() {}, late);
+		a.post_with_deadline([]() {}, late);
+	}).get();
+
+	concurency::workerStats totalA, totalB;
+	for (const auto& s : a.stats())
+		totalA.merge(s);
+	for (const auto& s : b.stats())
+		totalB.merge(s);
+	a.end();
+	b.end();
+
+	std::cout << "missed a " << totalA.missed << " b " << totalB.missed << ", b missed deadlines " << b.missedDeadlines() << std::endl;
+	if (totalA.missed != 1 || totalB.missed != 0 || a.missedDeadlines() != 1 || b.missedDeadlines() != 1)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testHistogram(); res != 0)
+		return res;
+	if (int res = testPoolStats(concurency::schedulingMode::random); res != 0)
+		return res;
+	if (int res = testPoolStats(concurency::schedulingMode::workStealing); res != 0)
+		return res;
+	if (int res = testSampling(); res != 0)
+		return res;
+	if (int res = testTwoPools(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include "tp/threadpool.h"
+#include "tp/mpmc_queue.h"
+#include "test_common.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+int testSingleThread()
+{
+	concurency::mpmc_queue<int> q{ 5 };
+	if (q.capacity() != 8)
+	{
+		std::cout << "capacity should be rounded up to 8: " << q.capacity() << std::endl;
+		return __LINE__;
+	}
+
+	for (int i = 0; i < 8; ++i)
+		if (!q.try_push(i))
+			return __LINE__;
+	if (q.try_push(8))
+	{
+		std::cout << "push to a full queue should fail" << std::endl;
+		return __LINE__;
+	}
+	if (q.size() != 8)
+		return __LINE__;
+
+	// two laps to check the sequence numbers wrap correctly
+	for (int lap = 0; lap < 2; ++lap)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			int out{ -1 };
+			if (!q.try_pop(out) || out != i + lap * 8)
+			{
+				std::cout << "expected " << i + lap * 8 << " got " << out << std::endl;
+				return __LINE__;
+			}
+			if (lap == 0 && !q.try_push(i + 8))
+				return __LINE__;
+		}
+	}
+
+	int out{ -1 };
+	if (q.try_pop(out) || !q.empty())
+	{
+		std::cout << "pop from an empty queue should fail" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// every produced value must be consumed exactly once
+int testMultiThread(size_t numProducers, size_t numConsumers)
+{
+	concurency::mpmc_queue<size_t> q{ 64 };
+	const size_t perProducer{ 100000 };
+	std::atomic<size_t> consumed{ 0 };
+	std::atomic<size_t> sum{ 0 };
+
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < numProducers; ++p)
+	{
+		threads.emplace_back([&q, p, perProducer]() {
+			for (size_t i = 0; i < perProducer; ++i)
+				while (!q.try_push(p * perProducer + i))
+					std::this_thread::yield();
+		});
+	}
+	for (size_t c = 0; c < numConsumers; ++c)
+	{
+		threads.emplace_back([&]() {
+			size_t item{ 0 };
+			while (consumed.load() < numProducers * perProducer)
+			{
+				if (q.try_pop(item))
+				{
+					sum.fetch_add(item);
+					consumed.fetch_add(1);
+				}
+				else
+					std::this_thread::yield();
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	const size_t total = numProducers * perProducer;
+	if (sum.load() != total * (total - 1) / 2)
+	{
+		std::cout << "items were lost or duplicated, producers " << numProducers << " consumers " << numConsumers << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+template<typename Pred>
+static bool waitFor(Pred&& pred, std::chrono::seconds timeout)
+{
+	const auto until = std::chrono::steady_clock::now() + timeout;
+	while (!pred())
+	{
+		if (std::chrono::steady_clock::now() > until)
+			return false;
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+/*
+	a task posts more than the capacity of the queue of its own worker, nobody else can make room.
+	the tasks that don't fit wait in the overflow list of the worker, the hashed ones keep their order.
+*/
+int testOwnQueueFull()
+{
+	using tp_t = concurency::threadPool<void, 128, concurency::mpmc_queue>;
+	const int numTasks{ 2000 };
+	static_assert(numTasks > concurency::mpmc_queue<int>::defaultCapacity, "must not fit in the queue");
+
+	tp_t tp;
+	tp.start(1);
+	std::atomic<int> done{ 0 };
+	std::vector<int> order;	// written only by the worker
+	tp.post([&]() {
+		for (int i = 0; i < numTasks; ++i)
+		{
+			tp.post([&done]() { done.fetch_add(1); });
+			tp.post([&order, &done, i]() { order.push_back(i); done.fetch_add(1); }, 7);
+		}
+	});
+	if (!waitFor([&done]() { return done.load() == 2 * numTasks; }, std::chrono::seconds(10)))
+		return __LINE__;
+	tp.end();
+	for (int i = 0; i < numTasks; ++i)
+	{
+		if (order[i] != i)
+			return __LINE__;
+	}
+
+	// two workers fill each other's queue at the same time
+	tp.start(2);
+	std::atomic<int> started{ 0 };
+	done.store(0);
+	for (uint32_t key : { 0u, 1u })
+	{
+		tp.post([&, key]() {
+			started.fetch_add(1);
+			while (started.load() != 2)
+				std::this_thread::yield();
+			for (int i = 0; i < numTasks; ++i)
+				tp.post([&done]() { done.fetch_add(1); }, 1 - key);
+		}, key);
+	}
+	if (!waitFor([&done]() { return done.load() == 2 * numTasks; }, std::chrono::seconds(10)))
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testSingleThread())
+		return res;
+	if (int res = testMultiThread(4, 1))
+		return res;
+	if (int res = testMultiThread(4, 4))
+		return res;
+
+	using tp_t = concurency::threadPool<void, 128, concurency::mpmc_queue>;
+	tp_t tp;
+	for (size_t i = 1; i < 5; i += 1)
+	{
+		tp.start(i); // tp.end() is called inside testThreadpool
+		if (int res = testCommon::testThreadpool<tp_t>(tp) != 0)
+			return res;
+	}
+	if (int res = testOwnQueueFull())
+		return res;
+	return 0;
+}
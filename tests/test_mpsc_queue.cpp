@@ -0,0 +1,161 @@
+#include "tp/threadpool.h"
+#include "tp/mpsc_queue.h"
+#include "test_common.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+int testSingleThread()
+{
+	concurency::mpsc_queue<std::unique_ptr<int>> q;
+	std::unique_ptr<int> out;
+	if (q.try_pop(out) || !q.empty())
+		return __LINE__;
+
+	// several rounds so nodes are recycled through block_pool
+	for (int round = 0; round < 1000; ++round)
+	{
+		for (int i = 0; i < 10; ++i)
+			q.try_push(std::make_unique<int>(i));
+		if (q.size() != 10)
+			return __LINE__;
+		for (int i = 0; i < 10; ++i)
+		{
+			if (!q.try_pop(out) || *out != i)
+			{
+				std::cout << "expected " << i << std::endl;
+				return __LINE__;
+			}
+		}
+		if (q.try_pop(out) || !q.empty())
+		{
+			std::cout << "queue should be empty" << std::endl;
+			return __LINE__;
+		}
+	}
+
+	// a chain of nodes is linked with one exchange
+	std::unique_ptr<int> items[5];
+	for (int i = 0; i < 5; ++i)
+		items[i] = std::make_unique<int>(i);
+	if (q.try_push_bulk(items, 5) != 5 || q.size() != 5)
+		return __LINE__;
+	for (int i = 0; i < 5; ++i)
+		if (!q.try_pop(out) || *out != i)
+			return __LINE__;
+
+	// destructor frees nodes that were not popped
+	for (int i = 0; i < 10; ++i)
+		q.try_push(std::make_unique<int>(i));
+	return 0;
+}
+
+// every item is consumed once and items of the same producer keep their order
+int testMultiThread(size_t numProducers)
+{
+	concurency::mpsc_queue<size_t> q;
+	const size_t perProducer{ 100000 };
+	const size_t total = numProducers * perProducer;
+
+	std::vector<std::thread> producers;
+	for (size_t p = 0; p < numProducers; ++p)
+	{
+		producers.emplace_back([&q, p, perProducer]() {
+			for (size_t i = 0; i < perProducer; ++i)
+				q.try_push(p * perProducer + i);
+		});
+	}
+
+	std::vector<size_t> next(numProducers, 0);
+	size_t consumed{ 0 };
+	size_t item{ 0 };
+	while (consumed < total)
+	{
+		if (!q.try_pop(item))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		const size_t p = item / perProducer;
+		if (item % perProducer != next[p])
+		{
+			std::cout << "producer " << p << " expected " << next[p] << " got " << item % perProducer << std::endl;
+			return __LINE__;
+		}
+		++next[p];
+		++consumed;
+	}
+	for (auto& t : producers)
+		t.join();
+
+	if (q.try_pop(item))
+		return __LINE__;
+	return 0;
+}
+
+// blocks freed by a thread of node 1 are handed only to threads of node 1
+int testPoolNodes()
+{
+	typedef concurency::block_pool<1000> pool_t;
+	std::vector<void*> freed;
+	std::thread{ [&freed]() {
+		concurency::detail::poolNode = 1;
+		for (int i = 0; i < 300; ++i)
+			freed.push_back(pool_t::allocate());
+		for (void* p : freed)
+			pool_t::deallocate(p);
+	} }.join();
+
+	auto allocatedOn = [](size_t node) {
+		void* p{ nullptr };
+		std::thread{ [&p, node]() {
+			concurency::detail::poolNode = node;
+			p = pool_t::allocate();
+			pool_t::deallocate(p);
+		} }.join();
+		return p;
+	};
+	if (std::find(freed.begin(), freed.end(), allocatedOn(0)) != freed.end())
+		return __LINE__;
+	if (std::find(freed.begin(), freed.end(), allocatedOn(1)) == freed.end())
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testSingleThread())
+		return res;
+	if (int res = testPoolNodes())
+		return res;
+	for (size_t n : {1, 4, 10})
+		if (int res = testMultiThread(n))
+			return res;
+
+	using tp_t = concurency::threadPool<void, 128, concurency::mpsc_queue>;
+	tp_t tp;
+	for (size_t i = 1; i < 5; i += 1)
+	{
+		tp.start(i); // tp.end() is called inside testThreadpool
+		if (int res = testCommon::testThreadpool<tp_t>(tp) != 0)
+			return res;
+	}
+
+	// single consumer worker queue with a stealable threadsafe_queue next to it
+	concurency::threadPool<bool, 128, concurency::mpsc_queue> stealing{ concurency::schedulingMode::workStealing };
+	stealing.start(3);
+	std::vector<std::future<bool>> futures;
+	for (size_t i = 0; i < 1024; ++i)
+	{
+		futures.push_back(stealing.push([]() { return true; }));
+		futures.push_back(stealing.push([]() { return true; }, static_cast<uint32_t>(i)));
+	}
+	for (auto& f : futures)
+		if (!f.get())
+			return __LINE__;
+	stealing.end();
+	return 0;
+}
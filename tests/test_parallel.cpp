@@ -0,0 +1,153 @@
+#include "tp/threadpool.h"
+#include "tp/parallel.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <random>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+typedef concurency::threadPool<void> pool_t;
+
+// every index exactly once, whatever the size and the grain
+int testFor(pool_t& tp)
+{
+	for (size_t size : { 0, 1, 7, 1000, 100003 })
+	{
+		for (size_t grain : { 0, 1, 100 })
+		{
+			std::vector<std::atomic<int>> seen(size);
+			concurency::parallel_for(tp, size_t{ 0 }, size, [&seen](size_t i) { seen[i].fetch_add(1, std::memory_order_relaxed); }, grain);
+			for (auto& s : seen)
+			{
+				if (s.load() != 1)
+					return __LINE__;
+			}
+		}
+	}
+
+	// a signed range that doesn't start at 0
+	std::atomic<long long> sum{ 0 };
+	concurency::parallel_for(tp, -500, 500, [&sum](int i) { sum.fetch_add(i); });
+	if (sum.load() != -500)
+		return __LINE__;
+	return 0;
+}
+
+int testReduce(pool_t& tp)
+{
+	std::vector<uint64_t> values(1000000);
+	std::iota(values.begin(), values.end(), 1);
+
+	if (concurency::parallel_reduce(tp, values.begin(), values.end(), uint64_t{ 0 }) != 1000000ull * 1000001ull / 2)
+		return __LINE__;
+	if (concurency::parallel_reduce(tp, values.begin(), values.end(), uint64_t{ 0 }, [](uint64_t a, uint64_t b) { return std::max(a, b); }) != 1000000)
+		return __LINE__;
+	if (concurency::parallel_reduce(tp, values.begin(), values.begin(), uint64_t{ 42 }) != 42)
+		return __LINE__;
+
+	const uint64_t squares = concurency::parallel_transform_reduce(tp, values.begin(), values.begin() + 1000, uint64_t{ 0 }, std::plus<>(),
+		[](uint64_t x) { return x * x; }, 1);
+	if (squares != 1000ull * 1001ull * 2001ull / 6)
+		return __LINE__;
+	return 0;
+}
+
+int testSort(pool_t& tp)
+{
+	std::mt19937 rng{ 11 };
+	for (size_t size : { 0, 1, 100, 5000, 100000, 1000003 })
+	{
+		std::vector<int> v(size);
+		for (auto& x : v)
+			x = static_cast<int>(rng() % 1000);
+		std::vector<int> expected = v;
+		std::sort(expected.begin(), expected.end());
+		concurency::parallel_sort(tp, v.begin(), v.end());
+		if (v != expected)
+			return __LINE__;
+
+		concurency::parallel_sort(tp, v.begin(), v.end(), std::greater<>(), 1000);
+		std::reverse(expected.begin(), expected.end());
+		if (v != expected)
+			return __LINE__;
+	}
+
+	// move only values
+	std::vector<std::unique_ptr<int>> ptrs;
+	for (int i = 0; i < 50000; ++i)
+		ptrs.push_back(std::make_unique<int>(static_cast<int>(rng() % 100000)));
+	concurency::parallel_sort(tp, ptrs.begin(), ptrs.end(), [](const auto& a, const auto& b) { return *a < *b; }, 1000);
+	if (!std::is_sorted(ptrs.begin(), ptrs.end(), [](const auto& a, const auto& b) { return *a < *b; }))
+		return __LINE__;
+	return 0;
+}
+
+// the first exception comes out, the pieces that did not start are skipped
+int testException(pool_t& tp)
+{
+	std::atomic<size_t> called{ 0 };
+	try
+	{
+		concurency::parallel_for(tp, 0, 1000000, [&called](int i) {
+			called.fetch_add(1, std::memory_order_relaxed);
+			if (i == 10)
+				throw std::runtime_error("stop");
+		}, 1000);
+		return __LINE__;
+	}
+	catch (std::runtime_error&) {}
+	if (called.load() == 1000000)
+		return __LINE__;
+	return 0;
+}
+
+// called from a task of the same pool with a single worker, the caller does the work
+int testNested()
+{
+	pool_t tp;
+	tp.start(1);
+	std::atomic<uint64_t> sum{ 0 };
+	std::atomic<bool> done{ false };
+	tp.post([&tp, &sum, &done]() {
+		std::vector<uint64_t> values(100000, 1);
+		sum.store(concurency::parallel_reduce(tp, values.begin(), values.end(), uint64_t{ 0 }));
+		done.store(true);
+	});
+	while (!done.load())
+		std::this_thread::yield();
+	tp.end();
+	if (sum.load() != 100000)
+		return __LINE__;
+
+	// not running, the caller does everything
+	std::vector<int> v{ 3, 1, 2 };
+	concurency::parallel_sort(tp, v.begin(), v.end(), std::less<>(), 1);
+	if (v != std::vector<int>{ 1, 2, 3 })
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		pool_t tp{ mode };
+		tp.start(4);
+		if (int res = testFor(tp); res != 0)
+			return res;
+		if (int res = testReduce(tp); res != 0)
+			return res;
+		if (int res = testSort(tp); res != 0)
+			return res;
+		if (int res = testException(tp); res != 0)
+			return res;
+		tp.end();
+	}
+	if (int res = testNested(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "tp/threadpool.h"
+#include "tp/placement.h"
+#include "test_common.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+
+template<typename Placement_t>
+int testAllThreadsUsed()
+{
+	using tp_t = concurency::threadPool<void, 128, concurency::threadsafe_queue, Placement_t>;
+	tp_t tp;
+	for (size_t i = 1; i < 5; i += 1)
+	{
+		tp.start(i); // tp.end() is called inside testThreadpool
+		if (int res = testCommon::testThreadpool<tp_t>(tp) != 0)
+			return res;
+	}
+	return 0;
+}
+
+// every worker gets exactly the same number of tasks
+int testRoundRobin()
+{
+	concurency::threadPool<void, 128, concurency::threadsafe_queue, concurency::roundRobinPlacement> tp;
+	const size_t numThreads{ 4 };
+	tp.start(numThreads);
+
+	std::map<std::thread::id, size_t> perThread;
+	std::mutex m;
+	for (size_t i = 0; i < numThreads * 8; ++i)
+	{
+		tp.push([&]() {
+			std::unique_lock<std::mutex> mlock(m);
+			++perThread[std::this_thread::get_id()];
+		});
+	}
+	tp.end();
+
+	if (perThread.size() != numThreads)
+		return __LINE__;
+	for (auto& p : perThread)
+	{
+		if (p.second != 8)
+		{
+			std::cout << "round robin gave " << p.second << " tasks to one worker instead of 8" << std::endl;
+			return __LINE__;
+		}
+	}
+	return 0;
+}
+
+// while worker 0 has a backlog, new tasks go to worker 1
+int testLeastLoaded()
+{
+	concurency::threadPool<std::thread::id, 128, concurency::threadsafe_queue, concurency::leastLoadedPlacement> tp;
+	tp.start(2);
+
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::promise<void> started0, started1;
+	auto blocker0 = tp.push([&started0, released]() { started0.set_value(); released.wait(); return std::this_thread::get_id(); }, 0);
+	auto blocker1 = tp.push([&started1, released]() { started1.set_value(); released.wait(); return std::this_thread::get_id(); }, 1);
+	started0.get_future().wait();
+	started1.get_future().wait();
+
+	std::vector<std::future<std::thread::id>> backlog;
+	for (size_t i = 0; i < 5; ++i)
+		backlog.push_back(tp.push([]() { return std::this_thread::get_id(); }, 0));
+
+	std::vector<std::future<std::thread::id>> placed;
+	for (size_t i = 0; i < 5; ++i)
+		placed.push_back(tp.push([]() { return std::this_thread::get_id(); }));
+
+	release.set_value();
+	blocker0.get();
+	const auto worker1 = blocker1.get();
+	for (auto& f : placed)
+	{
+		if (f.get() != worker1)
+		{
+			std::cout << "least loaded placement picked the busy worker" << std::endl;
+			return __LINE__;
+		}
+	}
+	for (auto& f : backlog)
+		f.get();
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testAllThreadsUsed<concurency::randomPlacement>())
+		return res;
+	if (int res = testAllThreadsUsed<concurency::roundRobinPlacement>())
+		return res;
+	if (int res = testAllThreadsUsed<concurency::powerOfTwoPlacement>())
+		return res;
+	if (int res = testAllThreadsUsed<concurency::leastLoadedPlacement>())
+		return res;
+	if (int res = testRoundRobin())
+		return res;
+	if (int res = testLeastLoaded())
+		return res;
+	return 0;
+}
@@ -0,0 +1,293 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <memory>
+
+using namespace std::chrono_literals;
+
+// the value goes down the chain, every step may change its type
+int testChain(concurency::schedulingMode mode)
+{
+	concurency::threadPool<int> tp{ mode };
+	tp.start(4);
+
+	std::vector<concurency::pool_future<size_t>> futures;
+	for (int i = 0; i < 1000; ++i)
+	{
+		futures.push_back(tp.submit([i]() { return i; })
+			.then([](int v) { return std::to_string(v * 2); })
+			.then([](std::string s) { return s.size(); }));
+	}
+	for (int i = 0; i < 1000; ++i)
+	{
+		if (futures[i].get() != std::to_string(i * 2).size())
+			return __LINE__;
+	}
+
+	// then on a future that is already set
+	auto ready = tp.submit([]() { return 7; });
+	ready.wait();
+	if (!ready.ready() || std::move(ready).then([](int v) { return v + 1; }).get() != 8)
+		return __LINE__;
+
+	// then and get consume the future
+	auto once = tp.submit([]() { return 1; });
+	auto next = once.then([](int v) { return v; });
+	if (once.valid() || !next.valid() || next.get() != 1 || next.valid())
+		return __LINE__;
+	try
+	{
+		next.get();
+		return __LINE__;
+	}
+	catch (std::future_error&) {}
+	tp.end();
+	return 0;
+}
+
+// an exception skips the rest of the chain and comes out of get()
+int testException()
+{
+	concurency::threadPool<int> tp;
+	tp.start(2);
+
+	std::atomic<int> called{ 0 };
+	auto f = tp.submit([]() -> int { throw std::runtime_error("first"); })
+		.then([&called](int v) { called.fetch_add(1); return v; })
+		.then([&called](int) { called.fetch_add(1); });
+	try
+	{
+		f.get();
+		return __LINE__;
+	}
+	catch (std::runtime_error& e)
+	{
+		if (std::string(e.what()) != "first")
+			return __LINE__;
+	}
+
+	auto g = tp.submit([]() { return 1; })
+		.then([](int) -> int { throw std::out_of_range("second"); })
+		.then([](int v) { return v; });
+	try
+	{
+		g.get();
+		return __LINE__;
+	}
+	catch (std::out_of_range&) {}
+	tp.end();
+	if (called.load() != 0)
+		return __LINE__;
+	return 0;
+}
+
+// without stealing a continuation runs on the worker that finished its predecessor
+int testSameWorker()
+{
+	concurency::threadPool<void> tp;
+	tp.start(4);
+
+	// the chains are complete before any task finishes, a continuation added to a finished future
+	// is queued by the thread that adds it
+	std::atomic<bool> gate{ false };
+	std::atomic<size_t> moved{ 0 };
+	std::vector<concurency::pool_future<void>> futures;
+	for (uint32_t i = 0; i < 200; ++i)
+	{
+		futures.push_back(tp.submit([&gate]() {
+				while (!gate.load())
+					std::this_thread::yield();
+			}, i)
+			.then([]() { return std::this_thread::get_id(); })
+			.then([&moved](std::thread::id first) {
+				if (first != std::this_thread::get_id())
+					moved.fetch_add(1);
+			}));
+	}
+	gate.store(true);
+	for (auto& f : futures)
+		f.get();
+	tp.end();
+	if (moved.load() != 0)
+		return __LINE__;
+	return 0;
+}
+
+// one worker, the chains and the joins wait without holding it
+int testNoBlocking()
+{
+	concurency::threadPool<int> tp;
+	tp.start(1);
+
+	std::atomic<bool> gate{ false };
+	auto first = tp.submit([&gate]() {
+		while (!gate.load())
+			std::this_thread::yield();
+		return 0;
+	});
+	auto chain = std::move(first).then([](int v) { return v + 1; });
+	for (int i = 0; i < 999; ++i)
+		chain = std::move(chain).then([](int v) { return v + 1; });
+
+	std::vector<concurency::pool_future<int>> parts;
+	for (int i = 1; i <= 100; ++i)
+		parts.push_back(tp.submit([i]() { return i; }));
+	auto sum = concurency::when_all(std::move(parts)).then([](std::vector<int> values) {
+		return std::accumulate(values.begin(), values.end(), 0);
+	});
+	gate.store(true);
+
+	if (chain.get() != 1000 || sum.get() != 5050)
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+int testWhenAll()
+{
+	concurency::threadPool<int> tp;
+	tp.start(4);
+
+	// values in the order of the futures, not of completion
+	std::vector<concurency::pool_future<int>> futures;
+	for (int i = 0; i < 50; ++i)
+		futures.push_back(tp.submit([i]() { std::this_thread::sleep_for(std::chrono::microseconds((50 - i) * 20)); return i; }));
+	auto all = concurency::when_all(std::move(futures)).get();
+	for (int i = 0; i < 50; ++i)
+	{
+		if (all[i] != i)
+			return __LINE__;
+	}
+
+	// one failure fails the whole
+	std::vector<concurency::pool_future<int>> failing;
+	failing.push_back(tp.submit([]() { return 1; }));
+	failing.push_back(tp.submit([]() -> int { throw std::runtime_error("failed"); }));
+	try
+	{
+		concurency::when_all(std::move(failing)).get();
+		return __LINE__;
+	}
+	catch (std::runtime_error&) {}
+
+	if (!concurency::when_all(std::vector<concurency::pool_future<int>>{}).get().empty())
+		return __LINE__;
+	tp.end();
+
+	concurency::threadPool<void> tv;
+	tv.start(2);
+	std::atomic<int> done{ 0 };
+	std::vector<concurency::pool_future<void>> voids;
+	for (int i = 0; i < 10; ++i)
+		voids.push_back(tv.submit([&done]() { done.fetch_add(1); }));
+	concurency::when_all(std::move(voids)).then([&done]() { return done.load(); }).get();
+	tv.end();
+	if (done.load() != 10)
+		return __LINE__;
+	return 0;
+}
+
+// the first one that finishes decides, an idle worker steals it when random placement puts it behind a blocked one
+int testWhenAny()
+{
+	concurency::threadPool<int> tp{ concurency::schedulingMode::workStealing };
+	tp.start(4);
+
+	std::atomic<bool> gate{ false };
+	std::vector<concurency::pool_future<int>> futures;
+	for (int i = 0; i < 3; ++i)
+		futures.push_back(tp.submit([&gate, i]() {
+			while (!gate.load())
+				std::this_thread::yield();
+			return i;
+		}));
+	futures.push_back(tp.submit([]() { return 42; }));
+	auto first = concurency::when_any(std::move(futures)).get();
+	gate.store(true);
+	if (first.first != 3 || first.second != 42)
+		return __LINE__;
+
+	std::vector<concurency::pool_future<int>> none;
+	try
+	{
+		concurency::when_any(std::move(none));
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	tp.end();
+	return 0;
+}
+
+// a continuation of a pool that ended runs on the thread that adds it
+int testEnded()
+{
+	concurency::threadPool<int> tp;
+	tp.start(1);
+	auto f = tp.submit([]() { return 5; });
+	f.wait();
+	tp.end();
+
+	const auto caller = std::this_thread::get_id();
+	auto next = std::move(f).then([caller](int v) { return std::this_thread::get_id() == caller ? v : -1; });
+	if (!next.ready() || next.get() != 5)
+		return __LINE__;
+
+	try
+	{
+		tp.submit([]() { return 1; });
+		return __LINE__;
+	}
+	catch (std::logic_error&) {}
+	return 0;
+}
+
+// a future outlives its pool, a continuation added after the pool is gone runs on the calling thread
+int testDestroyed()
+{
+	auto tp = std::make_unique<concurency::threadPool<int>>();
+	tp->start(2);
+	auto f = tp->submit([]() { return 7; });
+	auto pending = tp->submit([]() { return 8; }).then([](int v) { return v + 1; });
+	f.wait();
+	pending.wait();
+	tp.reset();
+
+	const auto caller = std::this_thread::get_id();
+	auto next = std::move(f).then([caller](int v) { return std::this_thread::get_id() == caller ? v : -1; });
+	if (!next.ready() || next.get() != 7)
+		return __LINE__;
+	if (std::move(pending).then([](int v) { return v * 2; }).get() != 18)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		if (int res = testChain(mode); res != 0)
+			return res;
+	}
+	if (int res = testException(); res != 0)
+		return res;
+	if (int res = testSameWorker(); res != 0)
+		return res;
+	if (int res = testNoBlocking(); res != 0)
+		return res;
+	if (int res = testWhenAll(); res != 0)
+		return res;
+	if (int res = testWhenAny(); res != 0)
+		return res;
+	if (int res = testEnded(); res != 0)
+		return res;
+	if (int res = testDestroyed(); res != 0)
+		return res;
+	return 0;
+}
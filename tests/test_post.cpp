@@ -0,0 +1,105 @@
+#include "tp/threadpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+int testPost(size_t numThreads)
+{
+	concurency::threadPool<bool> tp;
+	tp.start(numThreads);
+
+	std::atomic<size_t> cnt{ 0 };
+	std::atomic<size_t> ordered{ 0 };
+	std::atomic<bool> failed{ false };
+	const size_t iterations{ 1024 };
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		// the return value of a posted task is ignored
+		tp.post([&cnt]() { ++cnt; return true; });
+		tp.post([&ordered, &failed, expected = i]() {
+			if (ordered.load() != expected)
+				failed.store(true);
+			++ordered;
+		}, 3);
+	}
+	tp.end();
+
+	if (cnt.load() != iterations || ordered.load() != iterations)
+	{
+		std::cout << "not all posted tasks were executed " << cnt.load() << " " << ordered.load() << std::endl;
+		return __LINE__;
+	}
+	if (failed.load())
+	{
+		std::cout << "posted tasks with the same hash were reordered" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+int testExceptionHandler(size_t numThreads)
+{
+	concurency::threadPool<void> tp;
+	std::atomic<size_t> caught{ 0 };
+	tp.setExceptionHandler([&caught](std::exception_ptr ex) {
+		try
+		{
+			std::rethrow_exception(ex);
+		}
+		catch (const std::logic_error&)
+		{
+			++caught;
+		}
+	});
+	tp.start(numThreads);
+
+	const size_t iterations{ 256 };
+	std::atomic<size_t> cnt{ 0 };
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		tp.post([]() { throw std::logic_error{ "test exception handling" }; });
+		tp.post([&cnt]() { ++cnt; }); // workers survive the exceptions
+	}
+	tp.end();
+
+	if (caught.load() != iterations || cnt.load() != iterations)
+	{
+		std::cout << "caught " << caught.load() << " executed " << cnt.load() << " expected " << iterations << std::endl;
+		return __LINE__;
+	}
+
+	// a throwing handler must not kill the worker
+	tp.setExceptionHandler([](std::exception_ptr) { throw std::runtime_error{ "handler" }; });
+	tp.start(numThreads);
+	tp.post([]() { throw std::logic_error{ "test exception handling" }; }, 0);
+	std::future<void> f = tp.push([]() {}, 0);
+	if (std::future_status::ready != f.wait_for(std::chrono::seconds(5)))
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	concurency::threadPool<void> tp;
+	try
+	{
+		tp.post([]() {});
+		std::cout << "should have caugth expected std::logic_error" << std::endl;
+		return __LINE__;
+	}
+	catch (std::logic_error& ex)
+	{
+		std::cout << "caugth expected std::logic_error: " << ex.what() << std::endl;
+	}
+
+	for (size_t n : {1, 2, 3, 4})
+	{
+		if (int res = testPost(n))
+			return res;
+		if (int res = testExceptionHandler(n))
+			return res;
+	}
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <map>
+
+template<template<typename> class Queue_t>
+using prioPool_t = concurency::threadPool<void, 8, Queue_t, concurency::randomPlacement, concurency::moduloMapping, concurency::noMetrics, 3>;
+
+/*
+	one worker, blocked while 50 tasks of every level are queued, then released.
+	high is drained first, but low and normal get their share of every round (16 high, 4 normal, 1 low).
+*/
+template<template<typename> class Queue_t>
+int testLaneOrder(concurency::schedulingMode mode, bool hashed)
+{
+	prioPool_t<Queue_t> tp{ mode };
+	tp.start(1);
+
+	std::atomic<bool> gate{ false };
+	tp.post([&gate]() {
+		while (!gate.load())
+			std::this_thread::yield();
+	});
+
+	std::vector<size_t> order;	// written only by the worker
+	const size_t perLevel{ 50 };
+	for (size_t level : { 2, 1, 0 })
+	{
+		for (size_t i = 0; i < perLevel; ++i)
+		{
+			auto task = [&order, level]() { order.push_back(level); };
+			if (hashed)
+				tp.post(task, static_cast<uint32_t>(i), concurency::priority{ level });
+			else
+				tp.post(task, concurency::priority{ level });
+		}
+	}
+	gate.store(true);
+	tp.end();
+
+	if (order.size() != 3 * perLevel)
+		return __LINE__;
+	for (size_t i = 0; i < 16; ++i)
+	{
+		if (order[i] != 0)
+			return __LINE__;
+	}
+	size_t lastOf[3]{ 0, 0, 0 };
+	size_t firstLow{ order.size() };
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		lastOf[order[i]] = i;
+		if (order[i] == 2 && firstLow == order.size())
+			firstLow = i;
+	}
+	std::cout << "first low at " << firstLow << ", last high " << lastOf[0] << ", last normal " << lastOf[1] << std::endl;
+	if (firstLow > 21 || lastOf[0] >= lastOf[1] || lastOf[1] >= lastOf[2])
+		return __LINE__;
+	return 0;
+}
+
+// tasks of a key with the same priority keep their order, also across a resize
+int testKeyOrder()
+{
+	using pool_t = concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::jumpHashMapping, concurency::noMetrics, 3>;
+	pool_t tp;
+	tp.start(4);
+
+	const uint32_t numKeys{ 64 };
+	const size_t perKey{ 300 };
+	std::mutex mtx;
+	std::map<std::pair<uint32_t, size_t>, size_t> last;	// (key, level) -> last sequence
+	std::atomic<size_t> errors{ 0 };
+	for (size_t seq = 1; seq <= perKey; ++seq)
+	{
+		for (uint32_t key = 0; key < numKeys; ++key)
+		{
+			const size_t level = (seq + key) % 3;
+			tp.post([&, key, level, seq]() {
+				std::lock_guard<std::mutex> lock(mtx);
+				size_t& prev = last[{ key, level }];
+				if (prev >= seq)
+					errors.fetch_add(1);
+				prev = seq;
+			}, key, concurency::priority{ level });
+		}
+		if (seq == perKey / 3)
+			tp.resize(7);
+		if (seq == 2 * perKey / 3)
+			tp.resize(2);
+	}
+	tp.end();
+
+	if (errors.load() != 0)
+	{
+		std::cout << errors.load() << " tasks out of order" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+int testInvalid()
+{
+	prioPool_t<concurency::threadsafe_queue> tp;
+	tp.start(1);
+	try
+	{
+		tp.push([]() {}, concurency::priority{ 3 });
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	tp.push([]() {}, concurency::priority{ 2 }).get();
+
+	// a pool without priorities has only level 0
+	concurency::threadPool<void> plain;
+	plain.start(1);
+	plain.push([]() {}, concurency::priority{ 0 }).get();
+	try
+	{
+		plain.post([]() {}, 7, concurency::priority{ 1 });
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (bool hashed : { false, true })
+	{
+		if (int res = testLaneOrder<concurency::threadsafe_queue>(concurency::schedulingMode::random, hashed); res != 0)
+			return res;
+		if (int res = testLaneOrder<concurency::threadsafe_queue>(concurency::schedulingMode::workStealing, hashed); res != 0)
+			return res;
+		if (int res = testLaneOrder<concurency::mpsc_queue>(concurency::schedulingMode::random, hashed); res != 0)
+			return res;
+		if (int res = testLaneOrder<concurency::mpmc_queue>(concurency::schedulingMode::workStealing, hashed); res != 0)
+			return res;
+	}
+	if (int res = testKeyOrder(); res != 0)
+		return res;
+	if (int res = testInvalid(); res != 0)
+		return res;
+	return 0;
+}
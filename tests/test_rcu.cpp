@@ -0,0 +1,165 @@
+#include "tp/threadpool.h"
+#include "tp/rcu.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+struct data
+{
+	static constexpr uint64_t aliveMagic = 0x600d600d600d600d;
+	static constexpr uint64_t deadMagic = 0xdeaddeaddeaddead;
+
+	std::atomic<uint64_t> magic{ aliveMagic };
+	size_t value;
+};
+
+// synchronize returns only after a reader that was inside has left
+int testWaitsForReader()
+{
+	concurency::rcu_domain rcu;
+	rcu.synchronize(); // no readers, returns at once
+
+	std::atomic<bool> inside{ false };
+	std::atomic<bool> left{ false };
+	std::thread reader{ [&]() {
+		{
+			auto guard = rcu.read();
+			inside.store(true);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			left.store(true);
+		}
+	} };
+
+	while (!inside.load())
+		std::this_thread::yield();
+	rcu.synchronize();
+	const bool ok = left.load();
+	reader.join();
+	if (!ok)
+	{
+		std::cout << "synchronize returned while a reader was inside" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+/*
+	readers check that the published data is never freed under them,
+	the writer replaces it, waits for a grace period, poisons and frees the old one.
+	more threads than rcu_domain::maxReaders, so some of them use the overflow lock.
+*/
+int testReplace(size_t numReaders, size_t replacements)
+{
+	concurency::rcu_domain rcu;
+	std::atomic<data*> published{ new data{} };
+	published.load()->value = 0;
+
+	std::atomic<size_t> ready{ 0 };
+	std::atomic<bool> done{ false };
+	std::atomic<size_t> errors{ 0 };
+	std::atomic<size_t> reads{ 0 };
+
+	std::vector<std::thread> readers;
+	for (size_t r = 0; r < numReaders; ++r)
+	{
+		readers.emplace_back([&]() {
+			ready.fetch_add(1);
+			size_t last{ 0 };
+			while (!done.load())
+			{
+				auto guard = rcu.read();
+				const data* d = published.load(std::memory_order_acquire);
+				if (d->magic.load() != data::aliveMagic || d->value < last)
+					errors.fetch_add(1);
+				last = d->value;
+				std::this_thread::yield();
+				if (d->magic.load() != data::aliveMagic)
+					errors.fetch_add(1);
+				reads.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+	while (ready.load() != numReaders)
+		std::this_thread::yield();
+
+	for (size_t i = 1; i <= replacements; ++i)
+	{
+		data* d = new data{};
+		d->value = i;
+		data* old = published.exchange(d);
+		rcu.synchronize();
+		old->magic.store(data::deadMagic);
+		delete old;
+	}
+	done.store(true);
+	for (auto& t : readers)
+		t.join();
+	delete published.load();
+
+	std::cout << numReaders << " readers, " << reads.load() << " reads, " << replacements << " replacements" << std::endl;
+	if (errors.load() != 0)
+	{
+		std::cout << errors.load() << " reads of freed data" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// pushers never see a stopped worker, every accepted task runs
+int testPoolRestart()
+{
+	concurency::threadPool<void, 8, concurency::mpsc_queue> tp;
+	std::atomic<size_t> executed{ 0 };
+	std::atomic<size_t> accepted{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::vector<std::thread> pushers;
+	for (size_t p = 0; p < 4; ++p)
+	{
+		pushers.emplace_back([&, p]() {
+			while (!done.load())
+			{
+				try
+				{
+					tp.post([&executed]() { executed.fetch_add(1); }, static_cast<uint32_t>(p));
+					accepted.fetch_add(1);
+				}
+				catch (std::logic_error&)
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	for (size_t i = 0; i < 200; ++i)
+	{
+		tp.start(1 + i % 8);
+		std::this_thread::yield();
+		tp.end();
+	}
+	done.store(true);
+	for (auto& t : pushers)
+		t.join();
+
+	std::cout << accepted.load() << " tasks accepted, " << executed.load() << " executed" << std::endl;
+	if (accepted.load() != executed.load())
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testWaitsForReader(); res != 0)
+		return res;
+	if (int res = testReplace(4, 1000); res != 0)
+		return res;
+	if (int res = testReplace(concurency::rcu_domain::maxReaders + 8, 100); res != 0)
+		return res;
+	if (int res = testPoolRestart(); res != 0)
+		return res;
+	return 0;
+}
@@ -0,0 +1,317 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+// a bounded queue with room for 8 tasks, a worker that pushes to itself spills to its overflow list right away
+template<typename T>
+class smallQueue final
+{
+public:
+	bool try_push(T&& item) { return _queue.try_push(std::move(item)); }
+	bool try_pop(T& out) { return _queue.try_pop(out); }
+	size_t size()const { return _queue.size(); }
+	bool empty()const { return _queue.empty(); }
+
+private:
+	concurency::mpmc_queue<T> _queue{ 8 };
+};
+
+template<typename ThreadPool_t>
+int testBounds()
+{
+	ThreadPool_t tp;
+	try
+	{
+		tp.resize(2);
+		return __LINE__; // not running
+	}
+	catch (std::logic_error&) {}
+
+	tp.start(2);
+	try
+	{
+		tp.resize(0);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	try
+	{
+		tp.resize(tp.maxThreadNum() + 1);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+
+	tp.resize(tp.maxThreadNum());
+	if (tp.threadNum() != tp.maxThreadNum())
+		return __LINE__;
+	tp.resize(1);
+	if (tp.threadNum() != 1)
+		return __LINE__;
+	if (!tp.push([]() {}).valid())
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+/*
+	pushers push hashed tasks with a sequence number per key while another thread resizes the pool,
+	a task checks that the previous task of its key already ran.
+	no push may be rejected and every task runs.
+*/
+template<typename ThreadPool_t>
+int testOrderWhileResizing(concurency::schedulingMode mode)
+{
+	const size_t numKeys{ 64 };
+	const size_t numPushers{ 4 };
+	const size_t perPusher{ 100000 };
+
+	ThreadPool_t tp{ mode };
+	tp.start(3);
+
+	// every pusher owns its keys, so the sequence of a key is the push order
+	std::unique_ptr<std::atomic<size_t>[]> last{ new std::atomic<size_t>[numKeys * numPushers] };
+	for (size_t k = 0; k < numKeys * numPushers; ++k)
+		last[k].store(0);
+	std::atomic<size_t> errors{ 0 };
+	std::atomic<size_t> executed{ 0 };
+	std::atomic<size_t> rejected{ 0 };
+	std::atomic<size_t> pushersDone{ 0 };
+
+	std::vector<std::thread> pushers;
+	for (size_t p = 0; p < numPushers; ++p)
+	{
+		pushers.emplace_back([&, p]() {
+			std::vector<size_t> seq(numKeys, 0);
+			for (size_t i = 0; i < perPusher; ++i)
+			{
+				const size_t key = p * numKeys + i % numKeys;
+				const size_t s = ++seq[i % numKeys];
+				try
+				{
+					tp.post([&, key, s]() {
+						if (last[key].exchange(s) != s - 1)
+							errors.fetch_add(1);
+						executed.fetch_add(1);
+					}, static_cast<uint32_t>(key));
+					if (i % 1000 == 0) // unhashed tasks in between
+						tp.post([&executed]() { executed.fetch_add(1); });
+					if (i % 100 == 0)
+						std::this_thread::yield(); // let the resizer run between pushes on a small machine
+				}
+				catch (std::logic_error&)
+				{
+					rejected.fetch_add(1);
+				}
+			}
+			pushersDone.fetch_add(1);
+		});
+	}
+
+	const size_t sizes[] = { 5, 1, 8, 2, 7, 3, 4, 6 };
+	size_t resizes{ 0 };
+	while (pushersDone.load() != numPushers)
+	{
+		tp.resize(sizes[resizes++ % std::size(sizes)]);
+		if (tp.threadNum() != sizes[(resizes - 1) % std::size(sizes)])
+			return __LINE__;
+	}
+	for (auto& t : pushers)
+		t.join();
+	tp.end();
+
+	const size_t expected = numPushers * (perPusher + perPusher / 1000);
+	std::cout << resizes << " resizes, " << executed.load() << " tasks executed" << std::endl;
+	if (rejected.load() != 0)
+	{
+		std::cout << rejected.load() << " tasks rejected" << std::endl;
+		return __LINE__;
+	}
+	if (errors.load() != 0)
+	{
+		std::cout << errors.load() << " tasks out of order" << std::endl;
+		return __LINE__;
+	}
+	if (executed.load() != expected)
+	{
+		std::cout << "expected " << expected << " tasks" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// a batch of hashed tasks keeps its order per key across a resize
+int testBulkWhileResizing()
+{
+	concurency::threadPool<void, 8> tp;
+	tp.start(4);
+
+	const size_t numKeys{ 16 };
+	std::vector<size_t> last(numKeys, 0);	// a key runs on one worker at a time
+	std::atomic<size_t> errors{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::thread resizer{ [&]() {
+		for (size_t i = 0; !done.load(); ++i)
+			tp.resize(1 + i % 8);
+	} };
+
+	std::vector<std::pair<size_t, size_t>> batch; // key, sequence
+	std::vector<size_t> seq(numKeys, 0);
+	for (size_t round = 0; round < 200; ++round)
+	{
+		batch.clear();
+		for (size_t i = 0; i < 64; ++i)
+			batch.emplace_back(i % numKeys, ++seq[i % numKeys]);
+
+		std::vector<std::function<void()>> tasks;
+		for (auto [key, s] : batch)
+			tasks.push_back([&last, &errors, key = key, s = s]() {
+				if (last[key] + 1 != s)
+					errors.fetch_add(1);
+				last[key] = s;
+			});
+		size_t i{ 0 };
+		tp.post_bulk(std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()),
+			[&batch, &i](const auto&) { return static_cast<uint32_t>(batch[i++].first); });
+	}
+	done.store(true);
+	resizer.join();
+	tp.end();
+
+	if (errors.load() != 0)
+	{
+		std::cout << errors.load() << " batched tasks out of order" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+/*
+	schedulingMode::random with a multi consumer Queue_t: unhashed tasks have their own queue on the worker,
+	a hashed task isn't stuck behind an unhashed backlog and resize() doesn't wait for the backlog.
+*/
+template<typename ThreadPool_t>
+int testUnhashedBacklog()
+{
+	const size_t backlog{ 500 };
+
+	ThreadPool_t tp{ concurency::schedulingMode::random };
+	tp.start(1);
+
+	std::atomic<bool> gate{ false };
+	std::atomic<size_t> unhashed{ 0 };
+	std::atomic<bool> hashed{ false };
+	tp.post([&gate]() {
+		while (!gate.load())
+			std::this_thread::yield();
+	});
+	for (size_t i = 0; i < backlog; ++i)
+	{
+		tp.post([&unhashed]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			unhashed.fetch_add(1);
+		});
+	}
+	tp.post([&hashed]() { hashed.store(true); }, 0);
+	gate.store(true);
+
+	tp.resize(2);
+	const size_t atResize = unhashed.load();
+	if (!hashed.load())
+		return __LINE__;
+	tp.end();
+
+	std::cout << atResize << " of " << backlog << " unhashed tasks ran before resize returned" << std::endl;
+	if (atResize >= backlog / 2)
+		return __LINE__;
+	if (unhashed.load() != backlog)
+		return __LINE__;
+	return 0;
+}
+
+/*
+	a task on worker 0 pushes hashed tasks to its own full queue while another thread resizes,
+	most of them wait in the overflow list of worker 0. the barrier of resize() must queue behind them,
+	otherwise the held tasks of the keys that move are released before the older ones ran.
+*/
+int testOverflowWhileResizing()
+{
+	typedef concurency::threadPool<void, 8, smallQueue> pool_t;
+	const size_t numKeys{ 16 };
+	const size_t perRound{ 4000 };
+
+	pool_t tp;
+	tp.start(1);
+	std::vector<size_t> last(numKeys, 0);	// a key runs on one worker at a time
+	std::vector<size_t> seq(numKeys, 0);	// written by the pushing task only
+	std::atomic<size_t> errors{ 0 };
+	std::atomic<size_t> executed{ 0 };
+
+	for (size_t round = 0; round < 20; ++round)
+	{
+		std::atomic<size_t> pushed{ 0 };
+		std::thread resizer{ [&tp, &pushed, round]() {
+			while (pushed.load() < perRound / 4)
+				std::this_thread::yield();
+			tp.resize(round % 2 == 0 ? 2 : 1);
+		} };
+
+		// hash 0 stays on worker 0 with 1 and 2 workers
+		tp.post([&]() {
+			for (size_t i = 0; i < perRound; ++i)
+			{
+				const size_t key = i % numKeys;
+				const size_t s = ++seq[key];
+				tp.post([&, key, s]() {
+					if (last[key] + 1 != s)
+						errors.fetch_add(1);
+					last[key] = s;
+					executed.fetch_add(1);
+					std::this_thread::yield(); // its slot in the queue is free, a waiting pusher may take it
+				}, static_cast<uint32_t>(key));
+				pushed.store(i + 1);
+				if (i % 64 == 0)
+					std::this_thread::yield(); // let the resizer publish its table in the middle
+			}
+		}, 0);
+		resizer.join();
+	}
+	tp.end();
+
+	std::cout << executed.load() << " tasks pushed from a worker through its overflow list, " << errors.load() << " out of order" << std::endl;
+	if (errors.load() != 0 || executed.load() != 20 * perRound)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	using random_t = concurency::threadPool<void, 8>;
+	using mpsc_t = concurency::threadPool<void, 8, concurency::mpsc_queue>;
+	using mpmc_t = concurency::threadPool<void, 8, concurency::mpmc_queue>;
+
+	if (int res = testBounds<random_t>(); res != 0)
+		return res;
+	if (int res = testOrderWhileResizing<random_t>(concurency::schedulingMode::random); res != 0)
+		return res;
+	if (int res = testOrderWhileResizing<random_t>(concurency::schedulingMode::workStealing); res != 0)
+		return res;
+	if (int res = testOrderWhileResizing<mpsc_t>(concurency::schedulingMode::workStealing); res != 0)
+		return res;
+	if (int res = testOrderWhileResizing<mpmc_t>(concurency::schedulingMode::random); res != 0)
+		return res;
+	if (int res = testBulkWhileResizing(); res != 0)
+		return res;
+	if (int res = testOverflowWhileResizing(); res != 0)
+		return res;
+	if (int res = testUnhashedBacklog<random_t>(); res != 0)
+		return res;
+	if (int res = testUnhashedBacklog<mpmc_t>(); res != 0)
+		return res;
+	return 0;
+}
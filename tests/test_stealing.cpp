@@ -0,0 +1,97 @@
+#include "tp/threadpool.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <mutex>
+
+/*
+	one worker is blocked by a hashed task,
+	unhashed tasks that were placed on it must be stolen and executed by its sibling
+*/
+int testIdleWorkerSteals(size_t numThreads)
+{
+	concurency::threadPool<bool> tp{ concurency::schedulingMode::workStealing };
+	tp.start(numThreads);
+
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::future<bool> blocker = tp.push([released]() { released.wait(); return true; }, 0);
+
+	std::vector<std::future<bool>> futures;
+	for (size_t i = 0; i < 1024; ++i)
+		futures.push_back(tp.push([]() { return true; }));
+
+	for (auto& f : futures)
+	{
+		if (std::future_status::ready != f.wait_for(std::chrono::seconds(5)))
+		{
+			std::cout << "task was not stolen from the blocked worker, numThreads " << numThreads << std::endl;
+			release.set_value();
+			tp.end();
+			return __LINE__;
+		}
+	}
+
+	release.set_value();
+	if (!blocker.get())
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+/*
+	hashed tasks are never stolen, they are executed in order by the same thread
+*/
+int testHashedNotStolen(size_t numThreads)
+{
+	concurency::threadPool<void> tp{ concurency::schedulingMode::workStealing };
+	tp.start(numThreads);
+
+	const size_t cntTarget{ 256 };
+	std::atomic<size_t> cnt{ 0 };
+	std::atomic<bool> failed{ false };
+	std::set<std::thread::id> tids;
+	std::mutex m;
+
+	for (size_t i = 0; i < cntTarget; ++i)
+	{
+		tp.push([&, expected = i]() {
+			if (cnt.load() != expected)
+				failed.store(true);
+			{
+				std::unique_lock<std::mutex> mlock(m);
+				tids.insert(std::this_thread::get_id());
+			}
+			++cnt;
+		}, 7);
+		tp.push([]() { std::this_thread::yield(); });
+	}
+
+	tp.end();
+
+	if (failed.load() || cnt.load() != cntTarget)
+	{
+		std::cout << "hashed tasks were reordered, numThreads " << numThreads << std::endl;
+		return __LINE__;
+	}
+	if (tids.size() != 1)
+	{
+		std::cout << "hashed tasks were executed by " << tids.size() << " threads" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (size_t n : {2, 3, 4, 5})
+	{
+		if (int res = testIdleWorkerSteals(n))
+			return res;
+		if (int res = testHashedNotStolen(n))
+			return res;
+	}
+	return 0;
+}
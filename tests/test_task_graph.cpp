@@ -0,0 +1,250 @@
+#include "tp/threadpool.h"
+#include "tp/task_graph.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <atomic>
+#include <stdexcept>
+#include <limits>
+
+/*
+	a random DAG, edges go from lower to higher ids.
+	every node runs once per run and after all of its predecessors, run after run on the same graph.
+*/
+template<typename Pool_t>
+int testRandom(Pool_t& tp)
+{
+	const size_t numNodes{ 2000 };
+	std::mt19937 rng{ 3 };
+	concurency::task_graph g;
+	std::atomic<size_t> clock{ 0 };
+	std::vector<std::atomic<size_t>> finished(numNodes);
+	std::vector<std::atomic<int>> runs(numNodes);
+	std::vector<std::pair<size_t, size_t>> edges;
+
+	for (size_t i = 0; i < numNodes; ++i)
+		g.add([&clock, &finished, &runs, i]() { runs[i].fetch_add(1); finished[i].store(clock.fetch_add(1) + 1); }, 1 + rng() % 5);
+	for (size_t i = 1; i < numNodes; ++i)
+	{
+		for (int k = rng() % 4; k > 0; --k)
+		{
+			const size_t before = rng() % i;
+			g.precede(before, i);
+			edges.emplace_back(before, i);
+		}
+	}
+
+	for (int run = 1; run <= 20; ++run)
+	{
+		g.run(tp);
+		for (const auto& e : edges)
+		{
+			if (finished[e.first].load() >= finished[e.second].load())
+				return __LINE__;
+		}
+		for (auto& r : runs)
+		{
+			if (r.load() != run)
+				return __LINE__;
+		}
+	}
+	return 0;
+}
+
+// a single worker and a wide graph, nothing blocks so nothing deadlocks
+int testWide()
+{
+	concurency::threadPool<void> tp;
+	tp.start(1);
+	concurency::task_graph g;
+	std::atomic<size_t> ran{ 0 };
+	auto top = g.add([&ran]() { ran.fetch_add(1); });
+	auto bottom = g.add([&ran]() { ran.fetch_add(1); });
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto n = g.add([&ran]() { return ran.fetch_add(1); });	// the value is ignored
+		g.precede(top, n);
+		g.precede(n, bottom);
+	}
+	g.run(tp);
+	tp.end();
+	if (ran.load() != 1002)
+		return __LINE__;
+	return 0;
+}
+
+int testErrors()
+{
+	concurency::threadPool<void> tp;
+	concurency::task_graph g;
+	auto a = g.add([]() {});
+	auto b = g.add([]() {});
+	try
+	{
+		g.precede(a, a);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	try
+	{
+		g.precede(a, 7);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+
+	// not running
+	try
+	{
+		g.run(tp);
+		return __LINE__;
+	}
+	catch (std::logic_error&) {}
+
+	tp.start(2);
+	g.precede(a, b);
+	g.precede(b, a);
+	try
+	{
+		g.run(tp);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+
+	// a node that throws skips its successors, the next run is clean
+	concurency::task_graph h;
+	std::atomic<int> calls{ 0 };
+	bool fail{ true };
+	auto first = h.add([&fail]() {
+		if (fail)
+			throw std::runtime_error("fail");
+	});
+	auto second = h.add([&calls]() { calls.fetch_add(1); });
+	h.precede(first, second);
+	try
+	{
+		h.run(tp);
+		return __LINE__;
+	}
+	catch (std::runtime_error&) {}
+	if (calls.load() != 0)
+		return __LINE__;
+	fail = false;
+	h.run(tp);
+	if (calls.load() != 1)
+		return __LINE__;
+
+	concurency::task_graph empty;
+	empty.run(tp);
+	tp.end();
+	return 0;
+}
+
+/*
+	one worker, many short independent nodes are added before a long chain.
+	the head of the chain has the highest rank and runs first, with priority levels the chain runs ahead of the short nodes.
+*/
+int testCriticalPath()
+{
+	concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::noMetrics, 4> tp;
+	tp.start(1);
+
+	concurency::task_graph g;
+	std::vector<int> order;	// written by the only worker
+	const int numShort{ 50 }, chainLength{ 10 };
+	for (int i = 0; i < numShort; ++i)
+		g.add([&order]() { order.push_back(-1); });
+	concurency::task_graph::node_t prev{ 0 };
+	for (int i = 0; i < chainLength; ++i)
+	{
+		auto n = g.add([&order, i]() { order.push_back(i); });
+		if (i > 0)
+			g.precede(prev, n);
+		prev = n;
+	}
+	g.run(tp);
+	tp.end();
+
+	if (g.rank(numShort) != chainLength || g.rank(0) != 1)
+		return __LINE__;
+	if (order.size() != numShort + chainLength || order.front() != 0)
+		return __LINE__;
+
+	size_t lastShort{ 0 }, chainBeforeLast{ 0 };
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		if (order[i] == -1)
+			lastShort = i;
+		if (order[i] == chainLength - 2)
+			chainBeforeLast = i;
+	}
+	std::cout << "chain node " << chainLength - 2 << " ran " << chainBeforeLast << "th, the last short node " << lastShort << "th" << std::endl;
+	if (chainBeforeLast > lastShort)
+		return __LINE__;
+	return 0;
+}
+
+/*
+	costs close to UINT64_MAX: the ranks of the chain saturate and the levels still follow them,
+	the chain runs ahead of the short nodes as with small costs.
+*/
+int testHugeCosts()
+{
+	concurency::threadPool<void, 8, concurency::threadsafe_queue, concurency::randomPlacement, concurency::moduloMapping, concurency::noMetrics, 4> tp;
+	tp.start(1);
+
+	const uint64_t huge{ std::numeric_limits<uint64_t>::max() / 2 };
+	concurency::task_graph g;
+	std::vector<int> order;	// written by the only worker
+	const int numShort{ 20 }, chainLength{ 3 };
+	for (int i = 0; i < numShort; ++i)
+		g.add([&order]() { order.push_back(-1); });
+	concurency::task_graph::node_t prev{ 0 };
+	for (int i = 0; i < chainLength; ++i)
+	{
+		auto n = g.add([&order, i]() { order.push_back(i); }, huge);
+		if (i > 0)
+			g.precede(prev, n);
+		prev = n;
+	}
+	g.run(tp);
+	tp.end();
+
+	if (g.rank(numShort) != std::numeric_limits<uint64_t>::max() || g.rank(numShort + 1) != 2 * huge || g.rank(numShort + 2) != huge || g.rank(0) != 1)
+		return __LINE__;
+	if (order.size() != numShort + chainLength || order.front() != 0)
+		return __LINE__;
+
+	size_t lastShort{ 0 }, chainMiddle{ 0 };
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		if (order[i] == -1)
+			lastShort = i;
+		if (order[i] == 1)
+			chainMiddle = i;
+	}
+	if (chainMiddle > lastShort)
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		concurency::threadPool<void> tp{ mode };
+		tp.start(4);
+		if (int res = testRandom(tp); res != 0)
+			return res;
+		tp.end();
+	}
+	if (int res = testWide(); res != 0)
+		return res;
+	if (int res = testErrors(); res != 0)
+		return res;
+	if (int res = testCriticalPath(); res != 0)
+		return res;
+	if (int res = testHugeCosts(); res != 0)
+		return res;
+	return 0;
+}
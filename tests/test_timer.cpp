@@ -0,0 +1,259 @@
+#include "tp/threadpool.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+
+using namespace std::chrono_literals;
+
+/*
+	every item fires exactly once, in the advance() that passes its tick, never before it.
+	2 levels cover 4096 ticks, the later items go through the overflow list.
+*/
+template<size_t numLevels>
+int testWheel()
+{
+	concurency::timer_wheel<size_t, numLevels> wheel;
+	std::mt19937_64 rng{ 7 };
+	const size_t numItems{ 100000 };
+	std::vector<uint64_t> at(numItems);
+	std::vector<int> fired(numItems, 0);
+	for (size_t i = 0; i < numItems; ++i)
+	{
+		at[i] = 1 + rng() % (i % 10 == 0 ? 200000 : 5000);
+		wheel.add(at[i], i);
+	}
+	if (wheel.size() != numItems)
+		return __LINE__;
+
+	uint64_t now{ 0 };
+	size_t errors{ 0 };
+	while (!wheel.empty())
+	{
+		const uint64_t prev = now;
+		now += 1 + rng() % 300;
+		uint64_t last{ 0 };
+		wheel.advance(now, [&](uint64_t tick, size_t i) {
+			if (tick != at[i] || tick <= prev || tick > now || tick < last)
+				++errors;
+			last = tick;
+			++fired[i];
+		});
+		if (wheel.now() != now)
+			return __LINE__;
+		// items added while running land after now
+		if (now < 100000 && now % 7 == 0)
+		{
+			at.push_back(now + 1 + rng() % 10000);
+			fired.push_back(0);
+			wheel.add(at.back(), at.size() - 1);
+		}
+	}
+	for (int f : fired)
+	{
+		if (f != 1)
+			++errors;
+	}
+	if (errors != 0)
+	{
+		std::cout << "wheel<" << numLevels << ">: " << errors << " errors" << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+// delays are kept, never early, the shorter one first
+int testAfter()
+{
+	concurency::threadPool<void> tp;
+	tp.start(2);
+
+	const auto begin = std::chrono::steady_clock::now();
+	std::atomic<int64_t> first{ 0 }, second{ 0 };
+	auto elapsedUs = [begin]() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count(); };
+	tp.schedule_after(40ms, [&]() { second.store(elapsedUs()); });
+	tp.schedule_after(15ms, [&]() { first.store(elapsedUs()); });
+
+	while (second.load() == 0 && std::chrono::steady_clock::now() - begin < 5s)
+		std::this_thread::sleep_for(1ms);
+	tp.end();
+
+	std::cout << "after 15ms: " << first.load() << "us, after 40ms: " << second.load() << "us" << std::endl;
+	if (first.load() < 15000 || second.load() < 40000 || first.load() >= second.load())
+		return __LINE__;
+	return 0;
+}
+
+// a periodic timer keeps firing until it is cancelled
+int testEvery()
+{
+	concurency::threadPool<void> tp;
+	tp.start(2);
+
+	std::atomic<size_t> runs{ 0 };
+	auto handle = tp.schedule_every(5ms, [&runs]() { runs.fetch_add(1); });
+	std::this_thread::sleep_for(100ms);
+	if (!handle.pending() || !handle.cancel() || handle.pending() || handle.cancel())
+		return __LINE__;
+	std::this_thread::sleep_for(10ms); // a run posted before cancel may still finish
+	const size_t afterCancel = runs.load();
+	std::this_thread::sleep_for(50ms);
+	tp.end();
+
+	std::cout << "every 5ms for 100ms: " << afterCancel << " runs" << std::endl;
+	if (afterCancel < 5 || afterCancel > 25 || runs.load() != afterCancel)
+		return __LINE__;
+	return 0;
+}
+
+// the value a timer task returns is ignored, like with post()
+int testNonVoid()
+{
+	concurency::threadPool<void> tp;
+	tp.start(1);
+	std::atomic<int> runs{ 0 };
+	tp.schedule_after(1ms, [&runs]() { return runs.fetch_add(1) + 1; });
+	auto handle = tp.schedule_every(2ms, [&runs]() { return std::to_string(runs.fetch_add(1)); });
+	for (int i = 0; i < 1000 && runs.load() < 3; ++i)
+		std::this_thread::sleep_for(1ms);
+	handle.cancel();
+	tp.end();
+	if (runs.load() < 3)
+		return __LINE__;
+	return 0;
+}
+
+// slow periodic task, a period that comes while it runs is skipped
+int testNoOverlap()
+{
+	concurency::threadPool<void> tp;
+	tp.start(4);
+
+	std::atomic<int> inside{ 0 };
+	std::atomic<int> overlaps{ 0 };
+	std::atomic<size_t> runs{ 0 };
+	auto handle = tp.schedule_every(2ms, [&]() {
+		if (inside.fetch_add(1) != 0)
+			overlaps.fetch_add(1);
+		std::this_thread::sleep_for(7ms);
+		inside.fetch_sub(1);
+		runs.fetch_add(1);
+	});
+	std::this_thread::sleep_for(100ms);
+	handle.cancel();
+	tp.end();
+
+	std::cout << "slow periodic: " << runs.load() << " runs" << std::endl;
+	if (overlaps.load() != 0 || runs.load() == 0 || runs.load() > 20)
+		return __LINE__;
+	return 0;
+}
+
+int testCancel()
+{
+	concurency::threadPool<void> tp;
+	tp.start(1);
+
+	std::atomic<int> ran{ 0 };
+	auto cancelled = tp.schedule_after(30ms, [&ran]() { ran.fetch_add(1); });
+	auto fired = tp.schedule_after(1ms, [&ran]() { ran.fetch_add(10); });
+	if (!cancelled.pending() || !cancelled.cancel() || cancelled.pending())
+		return __LINE__;
+	std::this_thread::sleep_for(60ms);
+	if (ran.load() != 10 || fired.pending() || fired.cancel())
+		return __LINE__;
+
+	concurency::timerHandle none;
+	if (none.pending() || none.cancel())
+		return __LINE__;
+	tp.end();
+	return 0;
+}
+
+// many timers, all of them fire
+int testMany()
+{
+	concurency::threadPool<void> tp;
+	tp.start(2);
+
+	const size_t numTimers{ 200000 };
+	std::atomic<size_t> ran{ 0 };
+	const auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < numTimers; ++i)
+		tp.schedule_after(std::chrono::microseconds(i % 50000), [&ran]() { ran.fetch_add(1, std::memory_order_relaxed); });
+	const auto scheduled = std::chrono::steady_clock::now();
+
+	while (ran.load() != numTimers && std::chrono::steady_clock::now() - begin < 20s)
+		std::this_thread::sleep_for(5ms);
+	tp.end();
+
+	std::cout << numTimers << " timers scheduled in " << std::chrono::duration_cast<std::chrono::milliseconds>(scheduled - begin).count()
+		<< "ms, " << ran.load() << " ran" << std::endl;
+	if (ran.load() != numTimers)
+		return __LINE__;
+	return 0;
+}
+
+// end() drops the pending timers, a pool that is not running rejects new ones, a restarted pool takes them again
+int testEnd()
+{
+	concurency::threadPool<void> tp;
+	try
+	{
+		tp.schedule_after(1ms, []() {});
+		return __LINE__;
+	}
+	catch (std::logic_error&) {}
+
+	tp.start(1);
+	std::atomic<int> ran{ 0 };
+	auto late = tp.schedule_after(10s, [&ran]() { ran.fetch_add(1); });
+	auto periodic = tp.schedule_every(10s, [&ran]() { ran.fetch_add(1); });
+	const auto begin = std::chrono::steady_clock::now();
+	tp.end();
+	if (std::chrono::steady_clock::now() - begin > 1s || late.pending() || periodic.pending() || ran.load() != 0)
+		return __LINE__;
+	try
+	{
+		tp.schedule_every(1ms, []() {});
+		return __LINE__;
+	}
+	catch (std::logic_error&) {}
+
+	tp.start(1);
+	std::atomic<bool> done{ false };
+	tp.schedule_after(1ms, [&done]() { done.store(true); });
+	while (!done.load() && std::chrono::steady_clock::now() - begin < 5s)
+		std::this_thread::sleep_for(1ms);
+	tp.end();
+	if (!done.load())
+		return __LINE__;
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testWheel<5>(); res != 0)
+		return res;
+	if (int res = testWheel<2>(); res != 0)
+		return res;
+	if (int res = testAfter(); res != 0)
+		return res;
+	if (int res = testEvery(); res != 0)
+		return res;
+	if (int res = testNonVoid(); res != 0)
+		return res;
+	if (int res = testNoOverlap(); res != 0)
+		return res;
+	if (int res = testCancel(); res != 0)
+		return res;
+	if (int res = testMany(); res != 0)
+		return res;
+	if (int res = testEnd(); res != 0)
+		return res;
+	return 0;
+}
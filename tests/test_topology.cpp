@@ -0,0 +1,201 @@
+#include "tp/threadpool.h"
+#include "tp/topology.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+int testParse()
+{
+	typedef std::vector<int> v;
+	if (concurency::topology::parseCpuList("0-3,8,10-11\n") != v{ 0, 1, 2, 3, 8, 10, 11 })
+		return __LINE__;
+	if (concurency::topology::parseCpuList("5,1-2,2") != v{ 1, 2, 5 })
+		return __LINE__;
+	if (!concurency::topology::parseCpuList("\n").empty())
+		return __LINE__;
+	for (const char* bad : { "1-", "3-1", "a", "1,", "1;2", "-1" })
+	{
+		try
+		{
+			concurency::topology::parseCpuList(bad);
+			std::cout << "parsed " << bad << std::endl;
+			return __LINE__;
+		}
+		catch (std::invalid_argument&) {}
+	}
+	return 0;
+}
+
+static void write(const fs::path& path, const std::string& text)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream(path) << text << "\n";
+}
+
+/*
+	a copy of /sys of two sockets, 4 cores each with 2 threads and an L3:
+	node 0 - cpus 0-3 and their siblings 8-11, node 1 - cpus 4-7 and 12-15, node 2 has memory only
+*/
+static concurency::topology fakeTwoSockets(const fs::path& root)
+{
+	fs::remove_all(root);
+	write(root / "cpu/online", "0-15");
+	for (int cpu = 0; cpu < 16; ++cpu)
+	{
+		const fs::path dir = root / ("cpu/cpu" + std::to_string(cpu)) / "topology";
+		write(dir / "core_id", std::to_string(cpu % 4));
+		write(dir / "physical_package_id", std::to_string((cpu / 4) % 2));
+
+		// L1 data and instruction caches per core, one L3 per package
+		const fs::path cache = root / ("cpu/cpu" + std::to_string(cpu)) / "cache";
+		const std::string core = std::to_string(cpu % 8) + "," + std::to_string(cpu % 8 + 8);
+		write(cache / "index0/level", "1");
+		write(cache / "index0/type", "Data");
+		write(cache / "index0/shared_cpu_list", core);
+		write(cache / "index1/level", "1");
+		write(cache / "index1/type", "Instruction");
+		write(cache / "index1/shared_cpu_list", core);
+		write(cache / "index2/level", "3");
+		write(cache / "index2/type", "Unified");
+		write(cache / "index2/shared_cpu_list", (cpu / 4) % 2 == 0 ? "0-3,8-11" : "4-7,12-15");
+	}
+	write(root / "node/online", "0-2");
+	write(root / "node/node0/cpulist", "0-3,8-11");
+	write(root / "node/node1/cpulist", "4-7,12-15");
+	write(root / "node/node2/cpulist", "");
+	auto topo = concurency::topology::discover(root.string());
+	fs::remove_all(root);
+	return topo;
+}
+
+int testDiscover()
+{
+	const auto topo = fakeTwoSockets(fs::temp_directory_path() / "tp_test_topology");
+	if (topo.nodes() != 3 || topo.cpus().size() != 16 || !topo.cpusOf(2).empty())
+		return __LINE__;
+	if (topo.cpusOf(0) != std::vector<int>{ 0, 1, 2, 3, 8, 9, 10, 11 } || topo.cpusOf(1) != std::vector<int>{ 4, 5, 6, 7, 12, 13, 14, 15 })
+		return __LINE__;
+	if (topo.nodeOf(13) != 1 || topo.nodeOf(16) != -1)
+		return __LINE__;
+	if (topo.siblingsOf(1) != std::vector<int>{ 1, 9 } || topo.siblingsOf(14) != std::vector<int>{ 6, 14 })
+		return __LINE__;
+	if (topo.cacheSiblingsOf(9) != topo.cpusOf(0) || topo.cacheSiblingsOf(5) != topo.cpusOf(1) || topo.cpus()[13].cache != 4)
+		return __LINE__;
+
+	// nothing there, every cpu on node 0
+	const auto none = concurency::topology::discover((fs::temp_directory_path() / "tp_test_no_such_dir").string());
+	if (none.nodes() != 1 || none.cpusOf(0).empty())
+		return __LINE__;
+
+	// this machine
+	const auto real = concurency::topology::discover();
+	if (real.nodes() == 0)
+		return __LINE__;
+	for (const auto& c : real.cpus())
+	{
+		if (c.node < 0 || static_cast<size_t>(c.node) >= real.nodes())
+			return __LINE__;
+	}
+	std::cout << "this machine: " << real.cpus().size() << " cpus on " << real.nodes() << " nodes" << std::endl;
+	return 0;
+}
+
+int testSpec()
+{
+	const auto topo = fakeTwoSockets(fs::temp_directory_path() / "tp_test_spec");
+
+	auto spec = concurency::affinity_spec::parse("node:1*2; cpu:0,5 ;set:3-4*3;node:0", topo);
+	if (spec.size() != 2 + 2 + 3 + 8)
+		return __LINE__;
+	if (spec[0].node != 1 || spec[0].cpus != topo.cpusOf(1))
+		return __LINE__;
+	if (spec[2].cpus != std::vector<int>{ 0 } || spec[2].node != 0 || spec[3].node != 1)
+		return __LINE__;
+	if (spec[4].cpus != std::vector<int>{ 3, 4 } || spec[4].node != -1)
+		return __LINE__;
+	if (spec[14].node != 0 || spec[14].cpus.size() != 8)
+		return __LINE__;
+
+	for (const char* bad : { "node:2", "node:3", "cpu:1*2", "set:1*0", "core:1", "node:", "0-3" })
+	{
+		try
+		{
+			concurency::affinity_spec::parse(bad, topo);
+			std::cout << "parsed " << bad << std::endl;
+			return __LINE__;
+		}
+		catch (std::invalid_argument&) {}
+	}
+	try
+	{
+		concurency::affinity_spec{ topo }.addCpuSet({}, 1);
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	return 0;
+}
+
+// workers of this machine grouped by node, tasks run in both modes and after a resize
+int testPool(concurency::schedulingMode mode)
+{
+	concurency::affinity_spec spec;
+	for (size_t node = 0; node < spec.topo().nodes(); ++node)
+	{
+		if (!spec.topo().cpusOf(node).empty())
+			spec.addNode(static_cast<int>(node), 2);
+	}
+
+	concurency::threadPool<int> tp{ mode };
+	tp.start(spec);
+	if (tp.threadNum() != spec.size())
+		return __LINE__;
+
+	std::vector<std::future<int>> futures;
+	for (int i = 0; i < 10000; ++i)
+		futures.push_back(tp.push([i]() { return i; }));
+	for (int i = 0; i < 10000; ++i)
+	{
+		if (futures[i].get() != i)
+			return __LINE__;
+	}
+
+	tp.resize(spec.size() + 2);
+	std::atomic<int> done{ 0 };
+	for (int i = 0; i < 1000; ++i)
+		tp.post([&done]() { done.fetch_add(1); });
+	tp.end();
+	if (done.load() != 1000)
+		return __LINE__;
+
+	concurency::threadPool<int> empty;
+	try
+	{
+		empty.start(concurency::affinity_spec{ spec.topo() });
+		return __LINE__;
+	}
+	catch (std::invalid_argument&) {}
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testParse(); res != 0)
+		return res;
+	if (int res = testDiscover(); res != 0)
+		return res;
+	if (int res = testSpec(); res != 0)
+		return res;
+	for (auto mode : { concurency::schedulingMode::random, concurency::schedulingMode::workStealing })
+	{
+		if (int res = testPool(mode); res != 0)
+			return res;
+	}
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "tp/threadpool.h"
+#include "tp/unique_function.h"
+
+#include <memory>
+#include <string>
+#include <array>
+
+static int alive{ 0 };
+
+struct counted
+{
+	counted() { ++alive; }
+	counted(const counted&) { ++alive; }
+	counted(counted&&) noexcept { ++alive; }
+	~counted() { --alive; }
+};
+
+int testInlineAndHeap()
+{
+	using fn_t = concurency::unique_function<int()>;
+	static_assert(sizeof(fn_t) == 64, "unique_function should be one cache line");
+
+	// small callable, stored inline
+	auto small = [c = counted{}, v = 1]() { return v; };
+	static_assert(fn_t::fitsInline<decltype(small)>(), "small lambda should fit inline");
+	// big callable, stored on the heap
+	auto big = [c = counted{}, a = std::array<char, 128>{}]() { return static_cast<int>(a.size()); };
+	static_assert(!fn_t::fitsInline<decltype(big)>(), "big lambda should not fit inline");
+
+	{
+		fn_t f1{ std::move(small) };
+		fn_t f2{ std::move(big) };
+		if (f1() != 1 || f2() != 128)
+			return __LINE__;
+
+		fn_t f3{ std::move(f1) };
+		fn_t f4;
+		f4 = std::move(f2);
+		if (f1 || f2 || !f3 || !f4)
+		{
+			std::cout << "moved from unique_function should be empty" << std::endl;
+			return __LINE__;
+		}
+		if (f3() != 1 || f4() != 128)
+			return __LINE__;
+
+		f3 = nullptr;
+		if (f3)
+			return __LINE__;
+	}
+	// small and big still hold their moved-from captures
+	if (alive != 2)
+	{
+		std::cout << "captures were leaked or destroyed twice: " << alive << std::endl;
+		return __LINE__;
+	}
+	return 0;
+}
+
+int testMoveOnly()
+{
+	auto p = std::make_unique<std::string>("move only");
+	concurency::unique_function<size_t(size_t)> f{ [p = std::move(p)](size_t add) { return p->size() + add; } };
+	if (f(1) != 10)
+		return __LINE__;
+
+	// a void signature takes a callable that returns something and drops the result
+	int calls{ 0 };
+	concurency::unique_function<void()> dropped = [&calls]() { return ++calls; };
+	dropped();
+	if (calls != 1)
+		return __LINE__;
+
+	concurency::unique_function<void()> empty;
+	try
+	{
+		empty();
+		std::cout << "should have caugth expected std::bad_function_call" << std::endl;
+		return __LINE__;
+	}
+	catch (const std::bad_function_call&)
+	{
+	}
+	return 0;
+}
+
+// the pool accepts move only callables now that std::function is not in the way
+int testPoolMoveOnlyTask()
+{
+	concurency::threadPool<std::unique_ptr<int>> tp;
+	tp.start(2);
+
+	std::vector<std::future<std::unique_ptr<int>>> futures;
+	for (int i = 0; i < 1024; ++i)
+	{
+		auto p = std::make_unique<int>(i);
+		futures.push_back(tp.push([p = std::move(p)]() mutable { return std::move(p); }, static_cast<uint32_t>(i)));
+	}
+	for (int i = 0; i < 1024; ++i)
+	{
+		if (*futures[i].get() != i)
+			return __LINE__;
+	}
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	if (int res = testInlineAndHeap())
+		return res;
+	if (int res = testMoveOnly())
+		return res;
+	if (int res = testPoolMoveOnlyTask())
+		return res;
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include "tp/threadpool.h"
+#include "test_common.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+/*
+	workers go idle between bursts and must pick up the next burst
+	whether they are spinning, yielding or parked
+*/
+int testIdleBursts(concurency::waitStrategy wait, concurency::schedulingMode mode)
+{
+	concurency::threadPool<size_t> tp{ mode, wait };
+	tp.start(3);
+
+	for (size_t burst = 0; burst < 5; ++burst)
+	{
+		std::vector<std::future<size_t>> futures;
+		for (size_t i = 0; i < 100; ++i)
+			futures.push_back(tp.push([i]() { return i; }));
+		for (size_t i = 0; i < futures.size(); ++i)
+		{
+			if (std::future_status::ready != futures[i].wait_for(std::chrono::seconds(5)) || futures[i].get() != i)
+			{
+				std::cout << "task was not executed, spin " << wait.spinIterations << " yield " << wait.yieldIterations << std::endl;
+				return __LINE__;
+			}
+		}
+		// long enough for the workers to finish spinning and park
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	tp.end();
+	return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	const concurency::waitStrategy strategies[] = {
+		concurency::waitStrategy::park(),
+		concurency::waitStrategy::spinThenPark(),
+		concurency::waitStrategy{ 0, 100 },
+		concurency::waitStrategy{ 100000, 1000 },
+	};
+
+	for (const auto& wait : strategies)
+	{
+		if (int res = testIdleBursts(wait, concurency::schedulingMode::random))
+			return res;
+		if (int res = testIdleBursts(wait, concurency::schedulingMode::workStealing))
+			return res;
+
+		using tp_t = concurency::threadPool<void>;
+		tp_t tp{ concurency::schedulingMode::random, wait };
+		for (size_t i = 1; i < 5; i += 1)
+		{
+			tp.start(i); // tp.end() is called inside testThreadpool
+			if (int res = testCommon::testThreadpool<tp_t>(tp) != 0)
+				return res;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <condition_variable>
+
+namespace concurency
+{
+	/*
+		when autoscaleController changes the number of workers, the numbers are per sample
+
+		growQueued  - average queued tasks per worker that counts as a backlog,
+		              with a steady service rate the queueing delay grows with it, so it also bounds the latency
+		shrinkIdle  - share of the time the workers were parked that counts as idle, only with empty queues
+		growAfter   - consecutive backlog samples before the pool grows
+		shrinkAfter - consecutive idle samples before the pool shrinks
+		cooldown    - samples ignored after a change, the new size takes effect before the next decision
+		interval    - time between samples of autoscaler
+
+		backlog and idle are far apart and need several samples in a row, so the pool does not oscillate.
+		it grows by half of its size (at least 1) and shrinks by 1, fast reaction to load, slow release.
+	*/
+	struct autoscalePolicy
+	{
+		size_t minThreads{ 1 };
+		size_t maxThreads{ 1 };
+		size_t growQueued{ 4 };
+		double shrinkIdle{ 0.5 };
+		size_t growAfter{ 2 };
+		size_t shrinkAfter{ 10 };
+		size_t cooldown{ 5 };
+		std::chrono::milliseconds interval{ 100 };
+	};
+
+	/*
+		the decision of autoscaler without threads or clocks, one call per sample,
+		so it can be driven by a simulation.
+	*/
+	class autoscaleController final
+	{
+	public:
+		struct sample
+		{
+			size_t threads;		// current number of workers
+			size_t queued;		// tasks waiting in all the queues
+			double idle;		// share of the interval the workers were parked, [0, 1]
+		};
+
+		explicit autoscaleController(const autoscalePolicy& policy)
+			: _policy(policy)
+		{
+			if (_policy.minThreads == 0 || _policy.minThreads > _policy.maxThreads)
+				throw std::invalid_argument("autoscalePolicy needs 0 < minThreads <= maxThreads");
+		}
+
+		const autoscalePolicy& policy()const { return _policy; }
+
+		// returns the number of workers the pool should have
+		size_t decide(const sample& s)
+		{
+			const size_t bounded = std::clamp(s.threads, _policy.minThreads, _policy.maxThreads);
+			if (bounded != s.threads)
+				return changed(bounded);
+
+			if (_cooldown > 0)
+			{
+				--_cooldown;
+				return s.threads;
+			}
+
+			const bool backlog = s.queued > _policy.growQueued * s.threads;
+			const bool idle = s.queued == 0 && s.idle >= _policy.shrinkIdle;
+			_backlogSamples = backlog ? _backlogSamples + 1 : 0;
+			_idleSamples = idle ? _idleSamples + 1 : 0;
+
+			if (_backlogSamples >= _policy.growAfter && s.threads < _policy.maxThreads)
+				return changed(std::min(_policy.maxThreads, s.threads + std::max<size_t>(1, s.threads / 2)));
+			if (_idleSamples >= _policy.shrinkAfter && s.threads > _policy.minThreads)
+				return changed(s.threads - 1);
+			return s.threads;
+		}
+
+	private:
+		size_t changed(size_t threads)
+		{
+			_cooldown = _policy.cooldown;
+			_backlogSamples = 0;
+			_idleSamples = 0;
+			return threads;
+		}
+
+		const autoscalePolicy _policy;
+		size_t _backlogSamples{ 0 };
+		size_t _idleSamples{ 0 };
+		size_t _cooldown{ 0 };
+	};
+
+	/*
+		a controller thread that resizes a running threadPool within the bounds of autoscalePolicy.
+		every interval it samples threadPool::load() and passes it to autoscaleController.
+		a pool that is not running is left alone.
+
+		example:
+		concurency::threadPool<void> tp;
+		tp.start(2);
+		concurency::autoscalePolicy policy;
+		policy.minThreads = 2;
+		policy.maxThreads = 16;
+		concurency::autoscaler<decltype(tp)> scaler{ tp, policy };
+
+		the autoscaler must be destroyed before the pool.
+	*/
+	template<typename ThreadPool_t>
+	class autoscaler final
+	{
+	public:
+		autoscaler(ThreadPool_t& pool, const autoscalePolicy& policy)
+			: _pool(pool), _controller(policy)
+		{
+			if (policy.maxThreads > pool.maxThreadNum())
+				throw std::invalid_argument("autoscalePolicy maxThreads can't be greater than maxNumThreads");
+			_thread = std::thread{ [this]() { run(); } };
+		}
+		~autoscaler()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mtx);
+				_stop = true;
+			}
+			_cond.notify_one();
+			_thread.join();
+		}
+
+	private:
+		void run();
+
+		ThreadPool_t& _pool;
+		autoscaleController _controller;
+		std::mutex _mtx;
+		std::condition_variable _cond;
+		bool _stop{ false };	// guarded by _mtx
+		std::thread _thread;
+
+		autoscaler(const autoscaler&) = delete;
+		autoscaler& operator=(const autoscaler&) = delete;
+	};
+
+	template<typename ThreadPool_t>
+	void autoscaler<ThreadPool_t>::run()
+	{
+		typedef std::chrono::steady_clock clock_t;
+
+		std::vector<std::chrono::nanoseconds> prevIdle;	// per worker index
+		auto prevTime = clock_t::now();
+
+		std::unique_lock<std::mutex> lock(_mtx);
+		while (!_cond.wait_for(lock, _controller.policy().interval, [this]() { return _stop; }))
+		{
+			const auto now = clock_t::now();
+			const auto load = _pool.load();
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - prevTime);
+			prevTime = now;
+			if (load.empty())
+			{
+				prevIdle.clear();
+				continue; // not running
+			}
+
+			autoscaleController::sample s{ load.size(), 0, 0 };
+			std::chrono::nanoseconds idle{ 0 };
+			for (size_t i = 0; i < load.size(); ++i)
+			{
+				s.queued += load[i].queued;
+				if (i < prevIdle.size())
+					idle += load[i].idle - prevIdle[i];
+			}
+			// workers added since the last sample have no baseline yet, they count as busy once
+			if (elapsed.count() > 0)
+				s.idle = std::min(1.0, static_cast<double>(idle.count()) / (static_cast<double>(elapsed.count()) * static_cast<double>(load.size())));
+			prevIdle.resize(load.size());
+			for (size_t i = 0; i < load.size(); ++i)
+				prevIdle[i] = load[i].idle;
+
+			const size_t target = _controller.decide(s);
+			if (target == s.threads)
+				continue;
+
+			lock.unlock(); // resize waits for the workers, _stop is not held meanwhile
+			try
+			{
+				_pool.resize(target);
+			}
+			catch (std::logic_error&)
+			{
+				// the pool was ended meanwhile
+			}
+			lock.lock();
+		}
+	}
+}
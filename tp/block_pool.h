@@ -0,0 +1,225 @@
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstddef>
+
+namespace concurency
+{
+	namespace detail
+	{
+		// every block_pool keeps a global list per numa node, nodes above the last share lists
+		constexpr size_t maxPoolNodes = 8;
+		// the list this thread uses, a threadPool worker pinned to a node sets it, other threads use list 0
+		inline thread_local size_t poolNode{ 0 };
+	}
+
+	/*
+		free list of fixed size memory blocks, one pool per (blockSize, blockAlign).
+
+		every thread keeps a private cache of free blocks, allocate/deallocate normally touch only that cache.
+		a block is often allocated by one thread (pusher) and freed by another (worker),
+		so when a cache grows over maxCached it is moved as a whole to a global list,
+		and a thread with an empty cache takes the whole global list in one exchange.
+		taking the whole list avoids the ABA problem of a lock free stack pop.
+
+		there is a global list per numa node (detail::poolNode), a block freed by a worker goes to the list
+		of its node and is handed only to threads of that node, a block of the system is first touched by
+		the thread that allocates it, so the caches of a pinned worker hold memory of its node.
+
+		memory goes back to the system only when a thread exits (its cache) or at program exit (global lists).
+	*/
+	template<size_t blockSize, size_t blockAlign = alignof(std::max_align_t)>
+	class block_pool final
+	{
+	public:
+		static void* allocate();
+		static void deallocate(void* p) noexcept;
+
+	private:
+		struct freeBlock
+		{
+			freeBlock* next;
+		};
+
+		static constexpr size_t size = blockSize < sizeof(freeBlock) ? sizeof(freeBlock) : blockSize;
+		static constexpr size_t align = blockAlign < alignof(freeBlock) ? alignof(freeBlock) : blockAlign;
+		static constexpr size_t maxCached = 256;
+
+		// trivially destructible, stays valid for the whole life of the thread
+		struct localCache
+		{
+			freeBlock* head;
+			freeBlock* tail;
+			size_t count;
+			bool dead;	// the thread is exiting, blocks are freed directly
+		};
+		struct localCleanup
+		{
+			~localCleanup();
+		};
+		struct globalCleanup
+		{
+			~globalCleanup();
+		};
+
+		static void* systemAllocate() { return ::operator new(size, std::align_val_t{ align }); }
+		static void systemDeallocate(void* p) noexcept { ::operator delete(p, std::align_val_t{ align }); }
+		static void freeList(freeBlock* head) noexcept;
+		static void pushGlobal(freeBlock* head, freeBlock* tail) noexcept;
+		static void registerLocalCleanup();
+
+		static inline thread_local localCache _local{ nullptr, nullptr, 0, false };
+		static inline std::atomic<freeBlock*> _global[detail::maxPoolNodes]{};
+		static inline std::atomic<bool> _globalDead{ false };
+	};
+
+	/*
+		std allocator on top of block_pool, single objects come from the pool, arrays from the heap.
+		std::promise<T>(std::allocator_arg, pool_allocator<T>()) takes its shared state from the pool.
+	*/
+	template<typename T>
+	struct pool_allocator
+	{
+		typedef T value_type;
+
+		pool_allocator() noexcept = default;
+		template<typename U>
+		pool_allocator(const pool_allocator<U>&) noexcept {}
+
+		T* allocate(size_t n)
+		{
+			if (n == 1)
+				return static_cast<T*>(block_pool<sizeof(T), alignof(T)>::allocate());
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ alignof(T) }));
+		}
+		void deallocate(T* p, size_t n) noexcept
+		{
+			if (n == 1)
+				block_pool<sizeof(T), alignof(T)>::deallocate(p);
+			else
+				::operator delete(p, std::align_val_t{ alignof(T) });
+		}
+
+		template<typename U>
+		bool operator==(const pool_allocator<U>&)const noexcept { return true; }
+		template<typename U>
+		bool operator!=(const pool_allocator<U>&)const noexcept { return false; }
+	};
+
+
+	template<size_t blockSize, size_t blockAlign>
+	void* block_pool<blockSize, blockAlign>::allocate()
+	{
+		localCache& local = _local;
+		if (local.head == nullptr && !local.dead)
+		{
+			freeBlock* head = _global[detail::poolNode].exchange(nullptr, std::memory_order_acquire);
+			if (head == nullptr)
+			{
+				static globalCleanup cleanup; // frees the global lists at exit
+				return systemAllocate();
+			}
+
+			registerLocalCleanup();
+			local.head = head;
+			local.count = 0;
+			for (freeBlock* b = head; b != nullptr; b = b->next)
+			{
+				local.tail = b;
+				++local.count;
+			}
+		}
+		if (local.head == nullptr)
+			return systemAllocate();
+
+		freeBlock* b = local.head;
+		local.head = b->next;
+		if (--local.count == 0)
+			local.tail = nullptr;
+		return b;
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	void block_pool<blockSize, blockAlign>::deallocate(void* p) noexcept
+	{
+		if (p == nullptr)
+			return;
+
+		localCache& local = _local;
+		if (local.dead)
+		{
+			systemDeallocate(p);
+			return;
+		}
+		if (local.count == 0)
+			registerLocalCleanup();
+
+		freeBlock* b = static_cast<freeBlock*>(p);
+		b->next = local.head;
+		local.head = b;
+		if (local.tail == nullptr)
+			local.tail = b;
+		if (++local.count < maxCached)
+			return;
+
+		// hand the whole cache over to the threads that allocate
+		pushGlobal(local.head, local.tail);
+		local.head = local.tail = nullptr;
+		local.count = 0;
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	void block_pool<blockSize, blockAlign>::pushGlobal(freeBlock* head, freeBlock* tail) noexcept
+	{
+		if (_globalDead.load(std::memory_order_acquire))
+		{
+			freeList(head);
+			return;
+		}
+
+		std::atomic<freeBlock*>& global = _global[detail::poolNode];
+		freeBlock* expected = global.load(std::memory_order_relaxed);
+		do
+		{
+			tail->next = expected;
+		} while (!global.compare_exchange_weak(expected, head, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	void block_pool<blockSize, blockAlign>::freeList(freeBlock* head) noexcept
+	{
+		while (head != nullptr)
+		{
+			freeBlock* next = head->next;
+			systemDeallocate(head);
+			head = next;
+		}
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	void block_pool<blockSize, blockAlign>::registerLocalCleanup()
+	{
+		static thread_local localCleanup cleanup;
+		(void)cleanup;
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	block_pool<blockSize, blockAlign>::localCleanup::~localCleanup()
+	{
+		localCache& local = _local;
+		if (local.head != nullptr)
+			pushGlobal(local.head, local.tail);
+		local.head = local.tail = nullptr;
+		local.count = 0;
+		local.dead = true;
+	}
+
+	template<size_t blockSize, size_t blockAlign>
+	block_pool<blockSize, blockAlign>::globalCleanup::~globalCleanup()
+	{
+		_globalDead.store(true, std::memory_order_release);
+		for (auto& global : _global)
+			freeList(global.exchange(nullptr, std::memory_order_acquire));
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#if !(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#error "tp/coro.h needs C++20, the rest of tp/ is C++17"
+#endif
+
+#include <new>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <coroutine>
+#include <semaphore>
+
+#include "block_pool.h"
+#include "threadpool.h"
+
+/*
+	C++20 coroutines on top of threadPool, threadPool::schedule() / schedule_on(hash) are the awaitables that move a coroutine to a worker:
+
+	concurency::task<int> load(pool_t& tp, uint32_t key)
+	{
+		co_await tp.schedule_on(key);	// runs on the worker of key from here on
+		co_return read(key);
+	}
+	concurency::task<int> both(pool_t& tp)
+	{
+		co_await tp.schedule();
+		const int a = co_await load(tp, 1);
+		const int b = co_await load(tp, 2);
+		co_return a + b;
+	}
+	int sum = concurency::sync_wait(both(tp));
+*/
+
+namespace concurency
+{
+	template<typename T = void>
+	class task;
+
+	namespace detail
+	{
+		/*
+			coroutine frames up to maxPooledFrame bytes come from block_pool size classes of 64 << n bytes,
+			a worker that resumes many short coroutines reuses the frames from its cache.
+		*/
+		static constexpr size_t maxPooledFrame = 4096;
+
+		template<size_t blockSize = 64>
+		void* allocateFrame(size_t size)
+		{
+			if constexpr (blockSize > maxPooledFrame)
+				return ::operator new(size);
+			else
+			{
+				if (size <= blockSize)
+					return block_pool<blockSize>::allocate();
+				return allocateFrame<blockSize * 2>(size);
+			}
+		}
+		template<size_t blockSize = 64>
+		void deallocateFrame(void* p, size_t size) noexcept
+		{
+			if constexpr (blockSize > maxPooledFrame)
+				::operator delete(p);
+			else
+			{
+				if (size <= blockSize)
+					block_pool<blockSize>::deallocate(p);
+				else
+					deallocateFrame<blockSize * 2>(p, size);
+			}
+		}
+
+		struct taskPromiseBase
+		{
+			static void* operator new(size_t size) { return allocateFrame(size); }
+			static void operator delete(void* p, size_t size) noexcept { deallocateFrame(p, size); }
+
+			// lazy, the task starts when it is awaited
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			// the awaiting coroutine continues on this thread, without growing the stack
+			struct finalAwaiter
+			{
+				bool await_ready()const noexcept { return false; }
+				template<typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept { return h.promise().continuation; }
+				void await_resume()const noexcept {}
+			};
+			finalAwaiter final_suspend() noexcept { return {}; }
+
+			void unhandled_exception() noexcept { error = std::current_exception(); }
+
+			std::coroutine_handle<> continuation{ std::noop_coroutine() };
+			std::exception_ptr error;
+		};
+
+		template<typename T>
+		struct taskPromise final : taskPromiseBase
+		{
+			task<T> get_return_object() noexcept;
+
+			template<typename U>
+			void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+			T result()
+			{
+				if (error)
+					std::rethrow_exception(error);
+				return std::move(*value);
+			}
+
+			std::optional<T> value;
+		};
+
+		template<>
+		struct taskPromise<void> final : taskPromiseBase
+		{
+			task<void> get_return_object() noexcept;
+
+			void return_void() noexcept {}
+			void result()
+			{
+				if (error)
+					std::rethrow_exception(error);
+			}
+		};
+
+		// runs a task to the end and signals done, the frame is destroyed by sync_wait
+		struct syncRunner final
+		{
+			struct promise_type
+			{
+				static void* operator new(size_t size) { return allocateFrame(size); }
+				static void operator delete(void* p, size_t size) noexcept { deallocateFrame(p, size); }
+
+				syncRunner get_return_object() noexcept { return syncRunner{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+				std::suspend_always initial_suspend() noexcept { return {}; }
+				struct signal
+				{
+					bool await_ready()const noexcept { return false; }
+					void await_suspend(std::coroutine_handle<promise_type> h) noexcept { h.promise().done->release(); }
+					void await_resume()const noexcept {}
+				};
+				signal final_suspend() noexcept { return {}; }
+				void return_void() noexcept {}
+				void unhandled_exception() noexcept {}	// the task keeps its exception itself
+
+				std::binary_semaphore* done{ nullptr };
+			};
+
+			std::coroutine_handle<promise_type> handle;
+		};
+	}
+
+	/*
+		a lazy coroutine that returns T, started by co_await (or sync_wait), move only.
+		co_await on a task runs it on the current thread until it suspends, when it ends the awaiting coroutine
+		continues on the thread that ended it. an exception that leaves the task comes out of co_await.
+		the frame comes from block_pool when it is small enough (detail::maxPooledFrame).
+	*/
+	template<typename T>
+	class task final
+	{
+	public:
+		typedef detail::taskPromise<T> promise_type;
+		typedef std::coroutine_handle<promise_type> handle_t;
+
+		task() noexcept = default;
+		explicit task(handle_t h) noexcept : _h(h) {}
+		task(task&& rHnd) noexcept : _h(std::exchange(rHnd._h, nullptr)) {}
+		task& operator=(task&& rHnd) noexcept
+		{
+			if (this != &rHnd)
+			{
+				if (_h)
+					_h.destroy();
+				_h = std::exchange(rHnd._h, nullptr);
+			}
+			return *this;
+		}
+		~task()
+		{
+			if (_h)
+				_h.destroy();
+		}
+
+		bool valid()const noexcept { return static_cast<bool>(_h); }
+
+		bool await_ready()const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			_h.promise().continuation = awaiting;
+			return _h;
+		}
+		T await_resume() { return _h.promise().result(); }
+
+	private:
+		template<typename U>
+		friend U sync_wait(task<U> t);
+
+		handle_t _h;
+
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		task<T> taskPromise<T>::get_return_object() noexcept { return task<T>{ std::coroutine_handle<taskPromise<T>>::from_promise(*this) }; }
+		inline task<void> taskPromise<void>::get_return_object() noexcept { return task<void>{ std::coroutine_handle<taskPromise<void>>::from_promise(*this) }; }
+
+		template<typename T>
+		syncRunner runToEnd(task<T>& t)
+		{
+			// only waits, the value or the exception is taken by sync_wait
+			struct ended
+			{
+				task<T>& t;
+				bool await_ready()const noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept { return t.await_suspend(awaiting); }
+				void await_resume()const noexcept {}
+			};
+			co_await ended{ t };
+		}
+	}
+
+	/*
+		starts t on the calling thread and blocks until it ends, returns its value or rethrows its exception.
+		must not be called from a worker of the pool the task waits for.
+	*/
+	template<typename T>
+	T sync_wait(task<T> t)
+	{
+		std::binary_semaphore done{ 0 };
+		detail::syncRunner runner = detail::runToEnd(t);
+		runner.handle.promise().done = &done;
+		runner.handle.resume();
+		done.acquire();
+		runner.handle.destroy();
+		return t._h.promise().result();
+	}
+}
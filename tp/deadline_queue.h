@@ -0,0 +1,80 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace concurency
+{
+	/*
+		earliest deadline first queue, a binary heap behind a mutex.
+		try_pop returns the item with the earliest deadline, items with equal deadlines come out in push order.
+		any thread may push and pop.
+
+		the number of items is kept in an atomic next to the heap, so empty() and size() don't lock,
+		a consumer that polls an empty queue touches only that counter.
+	*/
+	template <typename T>
+	class deadline_queue final
+	{
+	public:
+		typedef std::chrono::steady_clock::time_point time_point;
+
+		deadline_queue() = default;
+
+		void push(T&& item, time_point deadline);
+		bool try_pop(T& out);
+
+		size_t size()const { return _size.load(std::memory_order_relaxed); }
+		bool empty()const { return size() == 0; }
+
+	private:
+		struct entry
+		{
+			time_point deadline;
+			uint64_t seq;
+			T item;
+		};
+		// std heaps keep the greatest on top, the earliest deadline must be the greatest
+		static bool later(const entry& a, const entry& b)
+		{
+			return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+		}
+
+		std::vector<entry> _heap;	// guarded by _mutex
+		uint64_t _seq{ 0 };			// guarded by _mutex
+		std::atomic<size_t> _size{ 0 };
+		mutable std::mutex _mutex;
+
+		deadline_queue(const deadline_queue&) = delete;
+		deadline_queue& operator=(const deadline_queue&) = delete;
+	};
+
+	template <typename T>
+	void deadline_queue<T>::push(T&& item, time_point deadline)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_heap.push_back({ deadline, _seq++, std::move(item) });
+		std::push_heap(_heap.begin(), _heap.end(), later);
+		_size.store(_heap.size());
+	}
+
+	template <typename T>
+	bool deadline_queue<T>::try_pop(T& out)
+	{
+		if (empty())
+			return false;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_heap.empty())
+			return false;
+		std::pop_heap(_heap.begin(), _heap.end(), later);
+		out = std::move(_heap.back().item);
+		_heap.pop_back();
+		_size.store(_heap.size());
+		return true;
+	}
+}
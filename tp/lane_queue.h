@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "platform.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace concurency
+{
+	namespace detail
+	{
+		// index of the lowest set bit, mask != 0
+		inline size_t lowestBit(uint32_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<size_t>(index);
+#else
+			return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+		}
+	}
+
+	/*
+		numLanes queues of one worker, one per priority level, lane 0 has the highest priority.
+		every lane is a Queue_t, so it is FIFO, tasks of one key pushed to one lane keep their order.
+
+		a bit per lane tells which lanes may hold tasks, consumers skip the empty lanes without touching them.
+		the pusher sets the bit after its task is in the lane, a consumer that finds the lane empty clears it
+		and looks at the lane again, like the _parked handshake of threadPool both sides have a seq_cst fence
+		between their write and their read, so a task is never left behind a clear bit.
+		with numLanes = 1 there is no bit, it is the plain Queue_t.
+	*/
+	template<typename Queue_t, size_t numLanes>
+	class lane_queue final
+	{
+		static_assert(numLanes >= 1 && numLanes <= 16, "lane_queue supports 1 to 16 lanes");
+
+	public:
+		Queue_t& lane(size_t index) { return _lanes[index]; }
+
+		// after the task is in lane(index) and a seq_cst fence
+		void pushed(size_t index)
+		{
+			if constexpr (numLanes > 1)
+			{
+				const uint32_t bit = uint32_t{ 1 } << index;
+				if ((_nonEmpty.load(std::memory_order_relaxed) & bit) == 0)
+					_nonEmpty.fetch_or(bit);
+			}
+		}
+
+		// the lanes that may hold tasks, bit i for lane i
+		uint32_t lanes()const
+		{
+			if constexpr (numLanes == 1)
+				return 1;
+			else
+				return _nonEmpty.load(std::memory_order_relaxed);
+		}
+
+		template<typename T>
+		bool try_pop(size_t index, T& out)
+		{
+			if constexpr (numLanes == 1)
+				return _lanes[0].try_pop(out);
+			else
+			{
+				const uint32_t bit = uint32_t{ 1 } << index;
+				if ((_nonEmpty.load(std::memory_order_relaxed) & bit) == 0)
+					return false;
+				Queue_t& q = _lanes[index];
+				if (q.try_pop(out))
+					return true;
+				_nonEmpty.fetch_and(~bit);
+				std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence before pushed()
+				if (q.empty())
+					return false;
+				_nonEmpty.fetch_or(bit);
+				return q.try_pop(out);
+			}
+		}
+
+		// strict priority, for consumers that don't own the queue (thieves)
+		template<typename T>
+		bool try_pop_highest(T& out)
+		{
+			for (uint32_t mask = lanes(); mask != 0; mask &= mask - 1)
+			{
+				if (try_pop(detail::lowestBit(mask), out))
+					return true;
+			}
+			return false;
+		}
+
+		size_t size()const
+		{
+			size_t res{ 0 };
+			for (const auto& q : _lanes)
+				res += q.size();
+			return res;
+		}
+		bool empty()const
+		{
+			for (const auto& q : _lanes)
+			{
+				if (!q.empty())
+					return false;
+			}
+			return true;
+		}
+
+	private:
+		std::array<Queue_t, numLanes> _lanes;
+		std::atomic<uint32_t> _nonEmpty{ 0 };
+	};
+
+	/*
+		the order in which a worker takes tasks from its lanes, weighted round robin:
+		in every round lane i gives up to weight(i) = 4^(numLanes - 1 - i) tasks, the lanes are asked from the highest,
+		so the higher lanes are drained first, while they are flooded a lower lane still gets
+		at least one task per round, e.g. with 3 lanes low gets 1 of every 21 tasks, normal 4, high 16.
+		a round ends when every lane that has tasks used its share.
+		with numLanes = 1 it asks lane 0 and keeps no state.
+		used only by the thread that owns it.
+	*/
+	template<size_t numLanes>
+	class weighted_round final
+	{
+	public:
+		static constexpr uint32_t weight(size_t lane) { return uint32_t{ 1 } << (2 * (numLanes - 1 - lane)); }
+
+		// mask - the lanes that may hold tasks, tryLane(lane) pops from one lane and returns true when it got a task
+		template<typename TryLane>
+		bool next(uint32_t mask, TryLane&& tryLane)
+		{
+			if constexpr (numLanes == 1)
+			{
+				(void)mask;
+				return tryLane(size_t{ 0 });
+			}
+			else
+			{
+				for (int round = 0; round < 2 && mask != 0; ++round)
+				{
+					bool spent{ false };	// a lane with tasks was skipped because it used its share
+					for (uint32_t m = mask; m != 0; m &= m - 1)
+					{
+						const size_t lane = detail::lowestBit(m);
+						if (_served[lane] >= weight(lane))
+						{
+							spent = true;
+							continue;
+						}
+						if (tryLane(lane))
+						{
+							++_served[lane];
+							return true;
+						}
+						mask &= ~(uint32_t{ 1 } << lane);
+					}
+					if (!spent)
+						return false;
+					_served.fill(0);
+				}
+				return false;
+			}
+		}
+
+	private:
+		std::array<uint32_t, numLanes> _served{};
+	};
+}
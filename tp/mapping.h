@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace concurency
+{
+	// splitmix64 finalizer, spreads close keys (0, 1, 2 ...) over all 64 bits
+	inline uint64_t mixKey(uint64_t key)
+	{
+		key += 0x9E3779B97F4A7C15ull;
+		key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+		key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+		return key ^ (key >> 31);
+	}
+
+	/*
+		mapping policies, map the hash of a task to a worker, tasks with equal hashes go to the same worker.
+		threadPool takes one as a template parameter.
+
+		static size_t map(uint32_t hash, size_t numWorkers) returns an index in [0, numWorkers).
+		consistent tells that adding workers moves keys only to the new workers
+		and removing the last workers moves only their keys,
+		resize() then holds back fewer keys and a shrink waits only for the retired workers.
+	*/
+
+	// hash % n, the cheapest, almost every key moves when n changes
+	struct moduloMapping
+	{
+		static constexpr bool consistent = false;
+
+		static size_t map(uint32_t hash, size_t numWorkers) { return hash % numWorkers; }
+	};
+
+	// jump consistent hash (Lamping, Veach), O(log n), no memory, 1/(n+1) of the keys move from n to n+1
+	struct jumpHashMapping
+	{
+		static constexpr bool consistent = true;
+
+		static size_t map(uint32_t hash, size_t numWorkers)
+		{
+			uint64_t key = mixKey(hash);
+			int64_t b = -1;
+			int64_t j = 0;
+			while (j < static_cast<int64_t>(numWorkers))
+			{
+				b = j;
+				key = key * 2862933555777941757ull + 1;
+				j = static_cast<int64_t>(static_cast<double>(b + 1) * (static_cast<double>(1ll << 31) / static_cast<double>((key >> 33) + 1)));
+			}
+			return static_cast<size_t>(b);
+		}
+	};
+
+	// rendezvous (highest random weight), O(n) per task, the worker with the highest weight for the key wins
+	struct rendezvousMapping
+	{
+		static constexpr bool consistent = true;
+
+		static size_t map(uint32_t hash, size_t numWorkers)
+		{
+			size_t best{ 0 };
+			uint64_t bestWeight{ 0 };
+			for (size_t i = 0; i < numWorkers; ++i)
+			{
+				const uint64_t weight = mixKey((static_cast<uint64_t>(hash) << 32) | static_cast<uint32_t>(i));
+				if (weight > bestWeight || i == 0)
+				{
+					best = i;
+					bestWeight = weight;
+				}
+			}
+			return best;
+		}
+	};
+}
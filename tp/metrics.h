@@ -0,0 +1,271 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace concurency
+{
+	namespace detail
+	{
+		// index of the highest set bit, v != 0
+		inline unsigned highestBit(uint64_t v)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, v);
+			return static_cast<unsigned>(index);
+#else
+			return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+		}
+
+		// single writer, so a relaxed load and store instead of a locked add
+		inline void bump(std::atomic<uint64_t>& counter, uint64_t by = 1)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+		}
+	}
+
+	/*
+		log linear buckets like HdrHistogram: values below 8 are exact,
+		every power of two above is split in 8 buckets, so a value is known within 12.5%.
+		covers the whole uint64_t range in nanoseconds with 496 buckets.
+	*/
+	struct histogramSnapshot
+	{
+		static constexpr unsigned subBits = 3;
+		static constexpr size_t subBuckets = size_t{ 1 } << subBits;
+		static constexpr size_t numBuckets = (64 - subBits + 1) * subBuckets;
+
+		std::array<uint64_t, numBuckets> counts{};
+
+		static size_t bucketOf(uint64_t v)
+		{
+			if (v < subBuckets)
+				return static_cast<size_t>(v);
+			const unsigned e = detail::highestBit(v);
+			const size_t sub = static_cast<size_t>(v >> (e - subBits)) & (subBuckets - 1);
+			return (e - subBits + 1) * subBuckets + sub;
+		}
+		// the highest value that falls in the bucket
+		static uint64_t highestOf(size_t bucket)
+		{
+			if (bucket < subBuckets)
+				return bucket;
+			const unsigned shift = static_cast<unsigned>(bucket / subBuckets - 1);
+			const uint64_t lowest = (subBuckets + bucket % subBuckets) << shift;
+			return lowest + ((uint64_t{ 1 } << shift) - 1);
+		}
+
+		uint64_t count()const
+		{
+			uint64_t res{ 0 };
+			for (uint64_t c : counts)
+				res += c;
+			return res;
+		}
+		// p in [0, 100], 0 when empty
+		uint64_t percentile(double p)const
+		{
+			const uint64_t total = count();
+			if (total == 0)
+				return 0;
+			const uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total - 1)) + 1;
+			uint64_t seen{ 0 };
+			for (size_t i = 0; i < numBuckets; ++i)
+			{
+				seen += counts[i];
+				if (seen >= rank)
+					return highestOf(i);
+			}
+			return highestOf(numBuckets - 1);
+		}
+		void merge(const histogramSnapshot& other)
+		{
+			for (size_t i = 0; i < numBuckets; ++i)
+				counts[i] += other.counts[i];
+		}
+	};
+
+	// written by one thread, read by any
+	class latencyHistogram final
+	{
+	public:
+		void record(uint64_t ns) { detail::bump(_counts[histogramSnapshot::bucketOf(ns)]); }
+
+		histogramSnapshot snapshot()const
+		{
+			histogramSnapshot res;
+			for (size_t i = 0; i < histogramSnapshot::numBuckets; ++i)
+				res.counts[i] = _counts[i].load(std::memory_order_relaxed);
+			return res;
+		}
+
+	private:
+		std::array<std::atomic<uint64_t>, histogramSnapshot::numBuckets> _counts{};
+	};
+
+	/*
+		what threadPool::stats() returns for one worker
+		executed - tasks it ran
+		stolen   - tasks it took from a sibling in schedulingMode::workStealing (included in executed)
+		parked   - times it parked on its condition_variable
+		missed   - tasks with a deadline it dropped because the deadline had passed (included in executed),
+		           and the late ones it pushed, they are dropped at push. a late push from a thread that is not
+		           a worker of the pool is counted only in threadPool::missedDeadlines()
+		queued   - tasks waiting in its queues now
+		wait     - ns from push to the start of the task
+		run      - ns the task ran
+		wait and run hold only the sampled tasks, see poolMetrics.
+	*/
+	struct workerStats
+	{
+		uint64_t executed{ 0 };
+		uint64_t stolen{ 0 };
+		uint64_t parked{ 0 };
+		uint64_t missed{ 0 };
+		size_t queued{ 0 };
+		histogramSnapshot wait;
+		histogramSnapshot run;
+
+		void merge(const workerStats& other)
+		{
+			executed += other.executed;
+			stolen += other.stolen;
+			parked += other.parked;
+			missed += other.missed;
+			queued += other.queued;
+			wait.merge(other.wait);
+			run.merge(other.run);
+		}
+	};
+
+	/*
+		metrics policies, threadPool takes one as a template parameter.
+
+		noMetrics (default) - nothing is counted, every hook is an empty inline function.
+		poolMetrics         - per worker counters and wait/run histograms, threadPool::stats() returns them.
+		                      the counters are bumped by their worker only, a relaxed load and store, no locked instruction.
+		                      timing a task costs 3 clock reads, only every timeEvery-th push of a thread is timed,
+		                      the other tasks pay for a thread local counter. timeEvery = 1 times every task.
+		                      a timed task carries its push time, 8 bytes more in its unique_function.
+		                      a task is timed and a drop counted only on a worker of its own pool, a task of another
+		                      pool run inline by a worker is left out rather than added to the wrong counters.
+	*/
+	struct noMetrics
+	{
+		static constexpr bool enabled = false;
+
+		struct workerCounters
+		{
+			void executed() {}
+			void stolen() {}
+			void parked() {}
+			void setCurrent(const void* /*owner*/) {}
+		};
+
+		template<typename F>
+		static F&& timed(F&& f, const void* /*owner*/) { return std::forward<F>(f); }
+		static void missed(const void* /*owner*/) {}
+	};
+
+	template<size_t timeEvery = 16>
+	struct poolMetrics
+	{
+		static_assert(timeEvery > 0, "timeEvery must be at least 1");
+		static constexpr bool enabled = true;
+
+		struct workerCounters
+		{
+			void executed() { detail::bump(_executed); }
+			void stolen() { detail::bump(_stolen); }
+			void parked() { detail::bump(_parked); }
+			void setCurrent(const void* owner) { _current = { owner, this }; }	// called by the worker thread, owner is its pool
+
+			workerStats snapshot()const
+			{
+				workerStats res;
+				res.executed = _executed.load(std::memory_order_relaxed);
+				res.stolen = _stolen.load(std::memory_order_relaxed);
+				res.parked = _parked.load(std::memory_order_relaxed);
+				res.missed = _missed.load(std::memory_order_relaxed);
+				res.wait = _wait.snapshot();
+				res.run = _run.snapshot();
+				return res;
+			}
+
+		private:
+			friend struct poolMetrics;
+
+			std::atomic<uint64_t> _executed{ 0 };
+			std::atomic<uint64_t> _stolen{ 0 };
+			std::atomic<uint64_t> _parked{ 0 };
+			std::atomic<uint64_t> _missed{ 0 };
+			latencyHistogram _wait;
+			latencyHistogram _run;
+		};
+
+		template<typename F>
+		static auto timed(F&& f, const void* owner)
+		{
+			return [f = std::forward<F>(f), pushedAt = sampledNow(), owner]() mutable {
+				if (pushedAt == 0)
+				{
+					f();
+					return;
+				}
+				const int64_t start = now();
+				f();
+				const int64_t end = now();
+				if (workerCounters* c = countersOf(owner))
+				{
+					c->_wait.record(static_cast<uint64_t>(start > pushedAt ? start - pushedAt : 0));
+					c->_run.record(static_cast<uint64_t>(end - start));
+				}
+			};
+		}
+
+		// called by a task that is dropped on its worker, or by a push that drops a late task
+		static void missed(const void* owner)
+		{
+			if (workerCounters* c = countersOf(owner))
+				detail::bump(c->_missed);
+		}
+
+	private:
+		static int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+		// 0 when this push is not timed
+		static int64_t sampledNow()
+		{
+			static thread_local size_t pushes{ 0 };
+			if (++pushes < timeEvery)
+				return 0;
+			pushes = 0;
+			return now();
+		}
+
+		// the counters of the worker running on this thread, when it is a worker of owner
+		static workerCounters* countersOf(const void* owner)
+		{
+			return _current.owner == owner ? _current.counters : nullptr;
+		}
+
+		// a thread local per Metrics_t type, shared by the pools of the same type, so it keeps the pool too
+		struct current
+		{
+			const void* owner;
+			workerCounters* counters;
+		};
+		static inline thread_local current _current{ nullptr, nullptr };
+	};
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+
+#include "platform.h"
+
+namespace concurency
+{
+	/*
+		bounded lock free multi producer multi consumer queue.
+		ring buffer of cells, every cell has a sequence number that tells
+		producers and consumers whether the cell is free or holds an item (Dmitry Vyukov's algorithm).
+
+		producers and consumers meet only on the cells, the enqueue and dequeue positions
+		are on separate cache lines.
+
+		non blocking, try_push fails when the queue is full, try_pop fails when it is empty.
+		capacity is rounded up to a power of 2.
+	*/
+	template <typename T>
+	class mpmc_queue final
+	{
+	public:
+		static constexpr size_t defaultCapacity = 1024;
+
+		explicit mpmc_queue(size_t capacity = defaultCapacity);
+		~mpmc_queue() = default;
+
+		bool try_push(T&& item);
+		bool try_push(const T& item);
+		bool try_pop(T& out);
+		size_t try_push_bulk(T* items, size_t count); // stops when the queue is full, returns how many were pushed
+
+		// approximate while producers or consumers are running
+		size_t size()const;
+		bool empty()const { return size() == 0; }
+		size_t capacity()const { return _mask + 1; }
+
+	private:
+		struct cell
+		{
+			std::atomic<size_t> sequence;
+			T data;
+		};
+
+		template <typename U>
+		bool push(U&& item);
+
+		static size_t roundUp(size_t capacity);
+
+		alignas(cacheLineSize) std::atomic<size_t> _enqueuePos{ 0 };
+		alignas(cacheLineSize) std::atomic<size_t> _dequeuePos{ 0 };
+		alignas(cacheLineSize) const size_t _mask;
+		std::unique_ptr<cell[]> _buffer;
+
+		mpmc_queue(const mpmc_queue&) = delete;
+		mpmc_queue& operator=(const mpmc_queue&) = delete;
+	};
+
+
+	template <typename T>
+	mpmc_queue<T>::mpmc_queue(size_t capacity)
+		: _mask(roundUp(capacity) - 1), _buffer(new cell[_mask + 1])
+	{
+		for (size_t i = 0; i <= _mask; ++i)
+			_buffer[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	template <typename T>
+	size_t mpmc_queue<T>::roundUp(size_t capacity)
+	{
+		if (capacity < 2)
+			throw std::invalid_argument("mpmc_queue capacity must be at least 2");
+		size_t res{ 1 };
+		while (res < capacity)
+			res <<= 1;
+		return res;
+	}
+
+	template <typename T>
+	bool mpmc_queue<T>::try_push(T&& item)
+	{
+		return push(std::move(item));
+	}
+
+	template <typename T>
+	bool mpmc_queue<T>::try_push(const T& item)
+	{
+		return push(item);
+	}
+
+	template <typename T>
+	template <typename U>
+	bool mpmc_queue<T>::push(U&& item)
+	{
+		cell* c{ nullptr };
+		size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			c = &_buffer[pos & _mask];
+			const size_t seq = c->sequence.load(std::memory_order_acquire);
+			const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (dif == 0)
+			{
+				// the cell is free, claim it
+				if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0)
+				return false; // full, the cell still holds an item from the previous lap
+			else
+				pos = _enqueuePos.load(std::memory_order_relaxed); // another producer took it
+		}
+
+		c->data = std::forward<U>(item);
+		c->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	template <typename T>
+	bool mpmc_queue<T>::try_pop(T& out)
+	{
+		cell* c{ nullptr };
+		size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			c = &_buffer[pos & _mask];
+			const size_t seq = c->sequence.load(std::memory_order_acquire);
+			const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (dif == 0)
+			{
+				if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0)
+				return false; // empty, or the producer did not finish writing yet
+			else
+				pos = _dequeuePos.load(std::memory_order_relaxed); // another consumer took it
+		}
+
+		out = std::move(c->data);
+		c->sequence.store(pos + _mask + 1, std::memory_order_release); // free for the next lap
+		return true;
+	}
+
+	template <typename T>
+	size_t mpmc_queue<T>::try_push_bulk(T* items, size_t count)
+	{
+		size_t pushed{ 0 };
+		while (pushed < count && push(std::move(items[pushed])))
+			++pushed;
+		return pushed;
+	}
+
+	template <typename T>
+	size_t mpmc_queue<T>::size()const
+	{
+		const size_t dequeuePos = _dequeuePos.load(std::memory_order_relaxed);
+		const size_t enqueuePos = _enqueuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "platform.h"
+#include "block_pool.h"
+
+namespace concurency
+{
+	// link embedded in the items of intrusive_mpsc_queue
+	struct mpsc_node
+	{
+		std::atomic<mpsc_node*> next{ nullptr };
+	};
+
+	/*
+		unbounded lock free multi producer single consumer queue of intrusive nodes (Dmitry Vyukov's algorithm).
+		push is one exchange and one store, pop touches only the consumer side unless the queue is almost empty.
+		the queue does not own the nodes.
+
+		try_pop may fail while a producer is in the middle of a push, the item will show up shortly after.
+	*/
+	class intrusive_mpsc_queue final
+	{
+	public:
+		intrusive_mpsc_queue() = default;
+
+		void push(mpsc_node* n)
+		{
+			push(n, n);
+		}
+
+		// first..last must be linked through next already, the whole chain is added with one exchange
+		void push(mpsc_node* first, mpsc_node* last)
+		{
+			last->next.store(nullptr, std::memory_order_relaxed);
+			mpsc_node* prev = _head.exchange(last, std::memory_order_acq_rel);
+			prev->next.store(first, std::memory_order_release);
+		}
+
+		// consumer only
+		mpsc_node* try_pop()
+		{
+			mpsc_node* tail = _tail.load(std::memory_order_relaxed);
+			mpsc_node* next = tail->next.load(std::memory_order_acquire);
+			if (tail == &_stub)
+			{
+				if (next == nullptr)
+					return nullptr;
+				_tail.store(next, std::memory_order_relaxed);
+				tail = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+			if (next != nullptr)
+			{
+				_tail.store(next, std::memory_order_relaxed);
+				return tail;
+			}
+			if (tail != _head.load(std::memory_order_acquire))
+				return nullptr; // a producer is linking a new node
+
+			// tail is the last node, put the stub behind it so tail can be detached
+			push(&_stub);
+			next = tail->next.load(std::memory_order_acquire);
+			if (next != nullptr)
+			{
+				_tail.store(next, std::memory_order_relaxed);
+				return tail;
+			}
+			return nullptr;
+		}
+
+		// approximate when called from a producer
+		bool empty()const
+		{
+			return _tail.load(std::memory_order_relaxed) == &_stub && _head.load(std::memory_order_acquire) == &_stub;
+		}
+
+	private:
+		alignas(cacheLineSize) std::atomic<mpsc_node*> _head{ &_stub };	// producers
+		alignas(cacheLineSize) std::atomic<mpsc_node*> _tail{ &_stub };	// consumer
+		mpsc_node _stub;
+
+		intrusive_mpsc_queue(const intrusive_mpsc_queue&) = delete;
+		intrusive_mpsc_queue& operator=(const intrusive_mpsc_queue&) = delete;
+	};
+
+	/*
+		multi producer single consumer queue of values on top of intrusive_mpsc_queue.
+		nodes come from block_pool, after warm up push and pop don't allocate.
+
+		only one thread may call try_pop, a worker of threadPool is the only consumer of its queue.
+		has the same interface as threadsafe_queue and mpmc_queue.
+	*/
+	template <typename T>
+	class mpsc_queue final
+	{
+	public:
+		static constexpr bool multiConsumer = false;
+
+		mpsc_queue() = default;
+		~mpsc_queue();
+
+		bool try_push(T&& item) { push(new (pool_t::allocate()) node(std::move(item))); return true; }
+		bool try_push(const T& item) { push(new (pool_t::allocate()) node(item)); return true; }
+		bool try_pop(T& out);
+		size_t try_push_bulk(T* items, size_t count); // links all the items first, then one exchange, returns count
+
+		// approximate while producers are running
+		size_t size()const;
+		bool empty()const { return _queue.empty(); }
+
+	private:
+		struct node : mpsc_node
+		{
+			template <typename U>
+			explicit node(U&& v) : value(std::forward<U>(v)) {}
+			T value;
+		};
+		typedef block_pool<sizeof(node), alignof(node)> pool_t;
+
+		void push(node* n)
+		{
+			_queue.push(n);
+			_pushed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		intrusive_mpsc_queue _queue;
+		alignas(cacheLineSize) std::atomic<size_t> _pushed{ 0 };	// producers
+		alignas(cacheLineSize) std::atomic<size_t> _popped{ 0 };	// consumer
+
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator=(const mpsc_queue&) = delete;
+	};
+
+
+	template <typename T>
+	mpsc_queue<T>::~mpsc_queue()
+	{
+		while (mpsc_node* n = _queue.try_pop())
+		{
+			static_cast<node*>(n)->~node();
+			pool_t::deallocate(n);
+		}
+	}
+
+	template <typename T>
+	bool mpsc_queue<T>::try_pop(T& out)
+	{
+		mpsc_node* n = _queue.try_pop();
+		if (n == nullptr)
+			return false;
+
+		node* valueNode = static_cast<node*>(n);
+		out = std::move(valueNode->value);
+		valueNode->~node();
+		pool_t::deallocate(valueNode);
+		_popped.store(_popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	template <typename T>
+	size_t mpsc_queue<T>::try_push_bulk(T* items, size_t count)
+	{
+		if (count == 0)
+			return 0;
+
+		node* first = new (pool_t::allocate()) node(std::move(items[0]));
+		node* last = first;
+		for (size_t i = 1; i < count; ++i)
+		{
+			node* n = new (pool_t::allocate()) node(std::move(items[i]));
+			last->next.store(n, std::memory_order_relaxed);
+			last = n;
+		}
+		_queue.push(first, last);
+		_pushed.fetch_add(count, std::memory_order_relaxed);
+		return count;
+	}
+
+	template <typename T>
+	size_t mpsc_queue<T>::size()const
+	{
+		const size_t popped = _popped.load(std::memory_order_relaxed);
+		const size_t pushed = _pushed.load(std::memory_order_relaxed);
+		return pushed > popped ? pushed - popped : 0;
+	}
+}
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <utility>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+#include "platform.h"
+
+/*
+	data parallel algorithms on a running threadPool (any pool with post() and threadNum()).
+	the calling thread takes part, it works on the range instead of blocking on futures,
+	so they can be called from a task of the same pool.
+
+	the range is split between the caller and up to threadNum() helper tasks.
+	each participant takes pieces of a quarter of what is left in its own part, at least grain items,
+	so the pieces get smaller towards the end. a participant that ran out splits the biggest part left
+	and takes its back half, a helper that starts late finds its part already taken.
+	grain = 0 picks one from the size of the range and the number of workers.
+
+	an exception thrown by func stops the pieces that did not start yet, the first one is rethrown to the caller.
+	a pool that is not running leaves the whole range to the caller.
+*/
+
+namespace concurency
+{
+	namespace detail
+	{
+		static constexpr size_t autoGrainSplits = 64;	// auto grain, pieces per participant if all were of grain size
+
+		// [begin, end) of one participant, the owner takes pieces from the front, thieves split off the back
+		struct alignas(cacheLineSize) workRange
+		{
+			std::mutex mtx;
+			size_t begin{ 0 };
+			size_t end{ 0 };
+		};
+
+		// the shared state of one call, the helper tasks keep it alive if they start after the call returned
+		class splitter final
+		{
+		public:
+			splitter(size_t size, size_t grain, size_t participants)
+				: _ranges(new workRange[participants]), _participants(participants), _grain(grain), _pending(size)
+			{
+				for (size_t p = 0; p < participants; ++p)
+				{
+					_ranges[p].begin = size * p / participants;
+					_ranges[p].end = size * (p + 1) / participants;
+				}
+			}
+
+			// body(participant, begin, end) for every piece this participant gets
+			template<typename Body>
+			void run(size_t participant, Body& body)
+			{
+				size_t begin, end;
+				while (take(participant, begin, end) || (steal(participant) && take(participant, begin, end)))
+				{
+					if (!_failed.load(std::memory_order_relaxed))
+					{
+						try
+						{
+							body(participant, begin, end);
+						}
+						catch (...)
+						{
+							if (!_failed.exchange(true))
+								_error = std::current_exception();
+						}
+					}
+					_pending.fetch_sub(end - begin, std::memory_order_acq_rel);
+				}
+			}
+
+			// until the pieces other participants took are done, then rethrows the first exception
+			void wait()
+			{
+				for (size_t spins = 0; _pending.load(std::memory_order_acquire) != 0; ++spins)
+				{
+					if (spins < 64)
+						cpuRelax();
+					else
+						std::this_thread::yield();
+				}
+				if (_failed.load())
+					std::rethrow_exception(_error);
+			}
+
+		private:
+			bool take(size_t participant, size_t& begin, size_t& end)
+			{
+				workRange& r = _ranges[participant];
+				std::lock_guard<std::mutex> lock(r.mtx);
+				const size_t left = r.end - r.begin;
+				if (left == 0)
+					return false;
+				begin = r.begin;
+				r.begin += std::min(left, std::max(_grain, left / 4));
+				end = r.begin;
+				return true;
+			}
+
+			// moves the back half of the biggest part to the own part, false when everything is taken
+			bool steal(size_t thief)
+			{
+				while (true)
+				{
+					size_t victim{ thief }, most{ 0 };
+					for (size_t p = 0; p < _participants; ++p)
+					{
+						if (p == thief)
+							continue;
+						std::lock_guard<std::mutex> lock(_ranges[p].mtx);
+						if (_ranges[p].end - _ranges[p].begin > most)
+						{
+							most = _ranges[p].end - _ranges[p].begin;
+							victim = p;
+						}
+					}
+					if (most == 0)
+						return false;
+
+					size_t begin, end;
+					{
+						workRange& r = _ranges[victim];
+						std::lock_guard<std::mutex> lock(r.mtx);
+						const size_t left = r.end - r.begin;
+						if (left == 0)
+							continue; // taken meanwhile, look again
+						end = r.end;
+						r.end -= left > _grain ? left / 2 : left;
+						begin = r.end;
+					}
+					workRange& own = _ranges[thief];
+					std::lock_guard<std::mutex> lock(own.mtx);
+					own.begin = begin;
+					own.end = end;
+					return true;
+				}
+			}
+
+			std::unique_ptr<workRange[]> _ranges;
+			const size_t _participants;
+			const size_t _grain;
+			cacheAligned<std::atomic<size_t>> _pending;	// items not done yet
+			std::atomic<bool> _failed{ false };
+			std::exception_ptr _error;	// written once, by the one that set _failed
+		};
+
+		struct parallelPlan
+		{
+			size_t grain;
+			size_t participants;
+		};
+
+		template<typename Pool_t>
+		parallelPlan planFor(const Pool_t& pool, size_t size, size_t grain)
+		{
+			const size_t threads = pool.threadNum() + 1;
+			if (grain == 0)
+				grain = std::max<size_t>(1, size / (threads * autoGrainSplits));
+			return { grain, std::max<size_t>(1, std::min(threads, (size + grain - 1) / grain)) };
+		}
+
+		template<typename Pool_t, typename Body>
+		void parallelRun(Pool_t& pool, size_t size, const parallelPlan& plan, Body& body)
+		{
+			if (size == 0)
+				return;
+			auto state = std::make_shared<splitter>(size, plan.grain, plan.participants);
+			for (size_t p = 1; p < plan.participants; ++p)
+			{
+				try
+				{
+					// a late helper gets nothing to take and doesn't touch body
+					pool.post([state, &body, p]() { state->run(p, body); });
+				}
+				catch (std::logic_error&)
+				{
+					break; // not running, the caller takes the parts of the missing helpers
+				}
+			}
+			state->run(0, body);
+			state->wait();
+		}
+
+		template<typename T>
+		struct alignas(cacheLineSize) partialResult
+		{
+			std::optional<T> value;
+		};
+	}
+
+	// func(i) for every i in [first, last)
+	template<typename Pool_t, typename Index, typename F>
+	void parallel_for(Pool_t& pool, Index first, Index last, F&& func, size_t grain = 0)
+	{
+		static_assert(std::is_integral_v<Index>, "parallel_for takes an integral range");
+		if (!(first < last))
+			return;
+
+		const size_t size = static_cast<size_t>(last - first);
+		auto body = [first, &func](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				func(static_cast<Index>(first + static_cast<Index>(i)));
+		};
+		detail::parallelRun(pool, size, detail::planFor(pool, size, grain), body);
+	}
+
+	/*
+		reduce(init, transform(x) for every x in [first, last)), random access iterators.
+		like std::transform_reduce, reduce must be associative and commutative, the pieces are combined in any order.
+	*/
+	template<typename Pool_t, typename It, typename T, typename Reduce, typename Transform>
+	T parallel_transform_reduce(Pool_t& pool, It first, It last, T init, Reduce&& reduce, Transform&& transform, size_t grain = 0)
+	{
+		const size_t size = static_cast<size_t>(std::distance(first, last));
+		if (size == 0)
+			return init;
+
+		const detail::parallelPlan plan = detail::planFor(pool, size, grain);
+		std::vector<detail::partialResult<T>> partials(plan.participants);
+		auto body = [first, &reduce, &transform, &partials](size_t participant, size_t begin, size_t end) {
+			It it = first + static_cast<typename std::iterator_traits<It>::difference_type>(begin);
+			T acc = transform(*it);
+			for (size_t i = begin + 1; i < end; ++i)
+				acc = reduce(std::move(acc), transform(*++it));
+			std::optional<T>& partial = partials[participant].value;
+			if (partial)
+				partial = reduce(std::move(*partial), std::move(acc));
+			else
+				partial = std::move(acc);
+		};
+		detail::parallelRun(pool, size, plan, body);
+
+		for (auto& partial : partials)
+		{
+			if (partial.value)
+				init = reduce(std::move(init), std::move(*partial.value));
+		}
+		return init;
+	}
+
+	// reduce(init, x for every x in [first, last)), see parallel_transform_reduce
+	template<typename Pool_t, typename It, typename T, typename Reduce = std::plus<>>
+	T parallel_reduce(Pool_t& pool, It first, It last, T init, Reduce&& reduce = Reduce(), size_t grain = 0)
+	{
+		return parallel_transform_reduce(pool, first, last, std::move(init), std::forward<Reduce>(reduce),
+			[](const auto& x) -> const auto& { return x; }, grain);
+	}
+
+	/*
+		sorts [first, last) of random access iterators, not stable.
+		blocks are sorted with std::sort in parallel, then merged pairwise in rounds through a buffer of the same size.
+		ranges of up to grain items (grain = 0 picks one) are sorted by the caller alone.
+	*/
+	template<typename Pool_t, typename It, typename Compare = std::less<>>
+	void parallel_sort(Pool_t& pool, It first, It last, Compare&& comp = Compare(), size_t grain = 0)
+	{
+		typedef typename std::iterator_traits<It>::value_type value_t;
+		typedef typename std::iterator_traits<It>::difference_type diff_t;
+
+		const size_t size = static_cast<size_t>(std::distance(first, last));
+		const size_t threads = pool.threadNum() + 1;
+		if (grain == 0)
+			grain = std::max<size_t>(4096, size / (threads * 16));
+		if (size <= grain || threads == 1)
+		{
+			std::sort(first, last, comp);
+			return;
+		}
+
+		// a few blocks per participant, so a slow block doesn't hold up the merge
+		const size_t numBlocks = std::min((size + grain - 1) / grain, threads * 4);
+		size_t width = (size + numBlocks - 1) / numBlocks;
+		parallel_for(pool, size_t{ 0 }, numBlocks, [&](size_t b) {
+			const size_t lo = std::min(size, b * width);
+			const size_t hi = std::min(size, lo + width);
+			std::sort(first + static_cast<diff_t>(lo), first + static_cast<diff_t>(hi), comp);
+		}, 1);
+
+		std::vector<value_t> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+		bool inBuffer{ true };	// the sorted blocks are in buffer
+		auto mergeRound = [&](auto src, auto dst) {
+			const size_t pairs = (size + 2 * width - 1) / (2 * width);
+			parallel_for(pool, size_t{ 0 }, pairs, [&](size_t p) {
+				const size_t lo = p * 2 * width;
+				const size_t mid = std::min(size, lo + width);
+				const size_t hi = std::min(size, lo + 2 * width);
+				std::merge(std::make_move_iterator(src + static_cast<diff_t>(lo)), std::make_move_iterator(src + static_cast<diff_t>(mid)),
+					std::make_move_iterator(src + static_cast<diff_t>(mid)), std::make_move_iterator(src + static_cast<diff_t>(hi)),
+					dst + static_cast<diff_t>(lo), comp);
+			}, 1);
+		};
+		for (; width < size; width *= 2)
+		{
+			if (inBuffer)
+				mergeRound(buffer.begin(), first);
+			else
+				mergeRound(first, buffer.begin());
+			inBuffer = !inBuffer;
+		}
+		if (inBuffer)
+		{
+			parallel_for(pool, size_t{ 0 }, size, [&](size_t i) {
+				first[static_cast<diff_t>(i)] = std::move(buffer[i]);
+			});
+		}
+	}
+}
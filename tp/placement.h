@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <functional>
+
+#include "platform.h"
+
+namespace concurency
+{
+	/*
+		xorshift64*, one generator per thread, seeded from the thread id and the address of its state.
+		a few ns per number, no syscall and no shared state.
+	*/
+	inline uint64_t threadLocalRandom()
+	{
+		static thread_local uint64_t state{ 0 };
+		if (state == 0)
+		{
+			state = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ reinterpret_cast<uintptr_t>(&state);
+			state = state * 0x9E3779B97F4A7C15ull | 1;
+		}
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+
+	/*
+		placement policies, pick the worker for a task that was pushed without a hash.
+		threadPool takes one as a template parameter.
+
+		size_t pick(size_t numWorkers, Depth depthOf) returns an index in [0, numWorkers),
+		depthOf(i) returns the number of tasks queued on worker i.
+		usesDepth tells the pool whether it has to count queued tasks per worker,
+		policies that don't look at the depth don't pay for the counting.
+	*/
+
+	// a random worker from a per thread generator
+	struct randomPlacement
+	{
+		static constexpr bool usesDepth = false;
+
+		template<typename Depth>
+		size_t pick(size_t numWorkers, Depth&&) { return threadLocalRandom() % numWorkers; }
+	};
+
+	// workers in turn, one shared counter per pool
+	struct roundRobinPlacement
+	{
+		static constexpr bool usesDepth = false;
+
+		template<typename Depth>
+		size_t pick(size_t numWorkers, Depth&&) { return _next.fetch_add(1, std::memory_order_relaxed) % numWorkers; }
+
+	private:
+		alignas(cacheLineSize) std::atomic<size_t> _next{ 0 };
+	};
+
+	// two random workers, the one with the shorter queue wins
+	struct powerOfTwoPlacement
+	{
+		static constexpr bool usesDepth = true;
+
+		template<typename Depth>
+		size_t pick(size_t numWorkers, Depth&& depthOf)
+		{
+			const uint64_t r = threadLocalRandom();
+			const size_t first = static_cast<size_t>(r % numWorkers);
+			const size_t second = static_cast<size_t>((r >> 32) % numWorkers);
+			return depthOf(second) < depthOf(first) ? second : first;
+		}
+	};
+
+	// scans all the workers for the shortest queue, starting from a random one to break ties
+	struct leastLoadedPlacement
+	{
+		static constexpr bool usesDepth = true;
+
+		template<typename Depth>
+		size_t pick(size_t numWorkers, Depth&& depthOf)
+		{
+			const size_t start = static_cast<size_t>(threadLocalRandom() % numWorkers);
+			size_t best = start;
+			size_t bestDepth = depthOf(start);
+			for (size_t i = 1; i < numWorkers && bestDepth != 0; ++i)
+			{
+				const size_t index = (start + i) % numWorkers;
+				const size_t depth = depthOf(index);
+				if (depth < bestDepth)
+				{
+					best = index;
+					bestDepth = depth;
+				}
+			}
+			return best;
+		}
+	};
+}
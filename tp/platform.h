@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace concurency
+{
+	/*
+		size of a cache line, used to pad data that is written by different threads.
+		std::hardware_destructive_interference_size is not used because its value may differ between compilers/flags.
+	*/
+	constexpr size_t cacheLineSize = 64;
+
+	/*
+		T alone on its own cache line(s), for an object written by one group of threads
+		while other threads read what was next to it.
+		derives from T, so it is used exactly like T.
+	*/
+	template<typename T>
+	struct alignas(cacheLineSize) cacheAligned : T
+	{
+		using T::T;
+		cacheAligned() = default;
+	};
+
+	// tells the cpu this is a spin loop, saves power and lets the sibling hyper thread run
+	inline void cpuRelax()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield" ::: "memory");
+#endif
+	}
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+#include <future>
+
+#include "unique_function.h"
+
+namespace concurency
+{
+	template<typename T>
+	class pool_future;
+
+	namespace detail
+	{
+		/*
+			the pool a continuation is queued to, without knowing its type, owned by the pool and its futures.
+			a future may outlive its pool, the pool retires the token in its destructor, post() then leaves the task
+			to the caller. post() holds a shared lock, so retire() waits for a post that is running.
+		*/
+		class executorToken final
+		{
+		public:
+			typedef bool (*post_t)(void* pool, unique_function<void()>& task);	// false when the pool did not take it
+
+			executorToken(void* pool, post_t post) : _pool(pool), _post(post) {}
+
+			bool post(unique_function<void()>& task)
+			{
+				std::shared_lock<std::shared_mutex> lock(_mtx);
+				return _pool != nullptr && _post(_pool, task);
+			}
+			void retire()
+			{
+				std::unique_lock<std::shared_mutex> lock(_mtx);
+				_pool = nullptr;
+			}
+
+		private:
+			std::shared_mutex _mtx;
+			void* _pool;
+			const post_t _post;
+		};
+
+		/*
+			threadPool::submit fills it, the task is queued on the calling worker when it is one of the pool.
+			a pool that is not running or is gone, or no pool at all, runs it on the calling thread.
+		*/
+		struct executorRef
+		{
+			std::shared_ptr<executorToken> token;
+
+			void execute(unique_function<void()>&& task)const
+			{
+				if (token == nullptr || !token->post(task))
+					task();
+			}
+		};
+
+		struct voidValue {};
+		template<typename T>
+		using storedValue_t = std::conditional_t<std::is_void_v<T>, voidValue, T>;
+
+		// the result of a pool_future and what waits for it
+		template<typename T>
+		class futureState final
+		{
+		public:
+			explicit futureState(const executorRef& executor) : _executor(executor) {}
+
+			const executorRef& executor()const { return _executor; }
+
+			template<typename... V>
+			void setValue(V&&... value)
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_value.emplace(std::forward<V>(value)...);
+				complete(lock);
+			}
+			void setError(std::exception_ptr error)
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_error = error;
+				complete(lock);
+			}
+
+			/*
+				c runs once the result is set, right away if it is already set.
+				queued - c is queued to the executor, otherwise it runs on the thread that sets the result (short bookkeeping only)
+			*/
+			void onReady(unique_function<void()>&& c, bool queued)
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				if (!_done)
+				{
+					_continuations.push_back({ std::move(c), queued });
+					return;
+				}
+				lock.unlock();
+				run({ std::move(c), queued });
+			}
+
+			bool ready()const
+			{
+				std::lock_guard<std::mutex> lock(_mtx);
+				return _done;
+			}
+			void wait()const
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_cond.wait(lock, [this]() { return _done; });
+			}
+			template<typename Rep, typename Period>
+			bool wait_for(const std::chrono::duration<Rep, Period>& timeout)const
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				return _cond.wait_for(lock, timeout, [this]() { return _done; });
+			}
+
+			// after wait(), the value is moved out or the exception is rethrown
+			storedValue_t<T> take()
+			{
+				wait();
+				if (_error)
+					std::rethrow_exception(_error);
+				return std::move(*_value);
+			}
+
+		private:
+			struct continuation
+			{
+				unique_function<void()> task;
+				bool queued;
+			};
+
+			void complete(std::unique_lock<std::mutex>& lock)
+			{
+				if (_done)
+					throw std::future_error(std::future_errc::promise_already_satisfied);
+				_done = true;
+				std::vector<continuation> continuations;
+				continuations.swap(_continuations);
+				lock.unlock();
+				_cond.notify_all();
+				for (auto& c : continuations)
+					run(std::move(c));
+			}
+			void run(continuation&& c)
+			{
+				if (c.queued)
+					_executor.execute(std::move(c.task));
+				else
+					c.task();
+			}
+
+			mutable std::mutex _mtx;
+			mutable std::condition_variable _cond;
+			bool _done{ false };
+			std::optional<storedValue_t<T>> _value;
+			std::exception_ptr _error;
+			std::vector<continuation> _continuations;
+			const executorRef _executor;
+		};
+
+		// sets the result of state to what f returns, or to the exception f throws
+		template<typename T, typename F>
+		void fulfill(futureState<T>& state, F&& f)
+		{
+			try
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					f();
+					state.setValue();
+				}
+				else
+					state.setValue(f());
+			}
+			catch (...)
+			{
+				state.setError(std::current_exception());
+			}
+		}
+
+		template<typename F, typename T>
+		struct continuationResult { typedef std::invoke_result_t<F, T> type; };
+		template<typename F>
+		struct continuationResult<F, void> { typedef std::invoke_result_t<F> type; };
+	}
+
+	template<typename T>
+	using when_any_result_t = std::conditional_t<std::is_void_v<T>, size_t, std::pair<size_t, T>>;
+
+	template<typename T>
+	pool_future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<pool_future<T>> futures);
+	template<typename T>
+	pool_future<when_any_result_t<T>> when_any(std::vector<pool_future<T>> futures);
+
+	/*
+		the result of threadPool::submit, like std::future it is move only and get() can be called once.
+		instead of blocking on get() the next step can be chained:
+
+		tp.submit([]() { return load(); })
+			.then([](data d) { return parse(d); })
+			.then([](doc x) { store(x); });
+
+		then(f) - f gets the value (nothing for void) and runs when the value is set, it is queued to the pool,
+		          to the worker that set the value when that was a worker of the pool, so the data is still in its cache.
+		          nothing blocks while the chain waits. returns the future of what f returns.
+		          if the predecessor threw, f is skipped and the exception goes down the chain.
+		          then() consumes the future, like get().
+		when_all(futures) - ready when all are, the values in the order of the futures (nothing for void),
+		                    the first exception (in order) if any of them threw.
+		when_any(futures) - ready when the first one is, its index (and value), or its exception.
+		a continuation of a pool that ended runs on the thread that sets the value.
+	*/
+	template<typename T>
+	class pool_future final
+	{
+	public:
+		pool_future() = default;
+		explicit pool_future(std::shared_ptr<detail::futureState<T>> state) : _state(std::move(state)) {}
+
+		bool valid()const { return _state != nullptr; }
+		bool ready()const { return state().ready(); }
+		void wait()const { state().wait(); }
+		template<typename Rep, typename Period>
+		std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout)const
+		{
+			return state().wait_for(timeout) ? std::future_status::ready : std::future_status::timeout;
+		}
+
+		T get()
+		{
+			auto s = std::move(_state);
+			if (!s)
+				throw std::future_error(std::future_errc::no_state);
+			if constexpr (std::is_void_v<T>)
+				s->take();
+			else
+				return s->take();
+		}
+
+		template<typename F>
+		pool_future<typename detail::continuationResult<F, T>::type> then(F&& func);
+
+	private:
+		template<typename U>
+		friend pool_future<std::conditional_t<std::is_void_v<U>, void, std::vector<U>>> when_all(std::vector<pool_future<U>> futures);
+		template<typename U>
+		friend pool_future<when_any_result_t<U>> when_any(std::vector<pool_future<U>> futures);
+
+		detail::futureState<T>& state()const
+		{
+			if (!_state)
+				throw std::future_error(std::future_errc::no_state);
+			return *_state;
+		}
+
+		std::shared_ptr<detail::futureState<T>> _state;
+	};
+
+	template<typename T>
+	template<typename F>
+	pool_future<typename detail::continuationResult<F, T>::type> pool_future<T>::then(F&& func)
+	{
+		typedef typename detail::continuationResult<F, T>::type next_t;
+
+		auto prev = std::move(_state);
+		if (!prev)
+			throw std::future_error(std::future_errc::no_state);
+		auto next = std::make_shared<detail::futureState<next_t>>(prev->executor());
+
+		// prev keeps the continuation, the continuation keeps prev, the cycle ends when prev is set
+		detail::futureState<T>& p = *prev;
+		p.onReady([prev = std::move(prev), next, f = std::forward<F>(func)]() mutable {
+			detail::fulfill(*next, [&]() -> next_t {
+				if constexpr (std::is_void_v<T>)
+				{
+					prev->take();
+					return f();
+				}
+				else
+					return f(prev->take());
+			});
+		}, true);
+		return pool_future<next_t>{ std::move(next) };
+	}
+
+	template<typename T>
+	pool_future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<pool_future<T>> futures)
+	{
+		typedef std::conditional_t<std::is_void_v<T>, void, std::vector<T>> all_t;
+
+		struct gather
+		{
+			std::mutex mtx;
+			size_t pending;
+			std::vector<std::shared_ptr<detail::futureState<T>>> states;
+		};
+
+		const detail::executorRef executor = futures.empty() ? detail::executorRef{} : futures.front().state().executor();
+		auto result = std::make_shared<detail::futureState<all_t>>(executor);
+		auto g = std::make_shared<gather>();
+		g->pending = futures.size();
+		for (auto& f : futures)
+		{
+			if (!f._state)
+				throw std::future_error(std::future_errc::no_state);
+			g->states.push_back(std::move(f._state));
+		}
+		if (g->states.empty())
+		{
+			detail::fulfill(*result, []() -> all_t { return all_t(); });
+			return pool_future<all_t>{ result };
+		}
+
+		// the last one to finish collects the values in order
+		auto states = g->states;
+		for (auto& s : states)
+		{
+			s->onReady([g, result]() {
+				{
+					std::lock_guard<std::mutex> lock(g->mtx);
+					if (--g->pending != 0)
+						return;
+				}
+				detail::fulfill(*result, [&g]() -> all_t {
+					if constexpr (std::is_void_v<T>)
+					{
+						for (auto& state : g->states)
+							state->take();
+					}
+					else
+					{
+						all_t values;
+						values.reserve(g->states.size());
+						for (auto& state : g->states)
+							values.push_back(state->take());
+						return values;
+					}
+				});
+			}, false);
+		}
+		return pool_future<all_t>{ result };
+	}
+
+	template<typename T>
+	pool_future<when_any_result_t<T>> when_any(std::vector<pool_future<T>> futures)
+	{
+		typedef when_any_result_t<T> any_t;
+
+		if (futures.empty())
+			throw std::invalid_argument("when_any needs at least one future");
+		for (auto& f : futures)
+		{
+			if (!f._state)
+				throw std::future_error(std::future_errc::no_state);
+		}
+
+		struct race
+		{
+			std::mutex mtx;
+			bool decided{ false };
+		};
+		auto result = std::make_shared<detail::futureState<any_t>>(futures.front().state().executor());
+		auto r = std::make_shared<race>();
+		for (size_t i = 0; i < futures.size(); ++i)
+		{
+			auto s = std::move(futures[i]._state);
+			detail::futureState<T>& state = *s;
+			state.onReady([r, result, i, s = std::move(s)]() {
+				{
+					std::lock_guard<std::mutex> lock(r->mtx);
+					if (r->decided)
+						return;
+					r->decided = true;
+				}
+				detail::fulfill(*result, [&]() -> any_t {
+					if constexpr (std::is_void_v<T>)
+					{
+						s->take();
+						return i;
+					}
+					else
+						return any_t{ i, s->take() };
+				});
+			}, false);
+		}
+		return pool_future<any_t>{ result };
+	}
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "platform.h"
+
+namespace concurency
+{
+	namespace detail
+	{
+		/*
+			a small number per live thread, 0, 1, 2 ...
+			the number of an exited thread is given to the next new thread, so the numbers stay dense.
+		*/
+		class threadIndex final
+		{
+		public:
+			static size_t get() { return _owner.index; }
+
+		private:
+			struct registry
+			{
+				std::mutex mtx;
+				std::vector<size_t> freeList;
+				size_t next{ 0 };
+			};
+			// never destroyed, a thread may exit after the static destructors ran
+			static registry& reg()
+			{
+				static registry* r = new registry;
+				return *r;
+			}
+
+			struct owner
+			{
+				owner()
+				{
+					registry& r = reg();
+					std::lock_guard<std::mutex> lock(r.mtx);
+					if (r.freeList.empty())
+						index = r.next++;
+					else
+					{
+						index = r.freeList.back();
+						r.freeList.pop_back();
+					}
+				}
+				~owner()
+				{
+					registry& r = reg();
+					std::lock_guard<std::mutex> lock(r.mtx);
+					r.freeList.push_back(index);
+				}
+				size_t index;
+			};
+
+			static inline thread_local owner _owner;
+		};
+	}
+
+	/*
+		read-copy-update for data that is read on every call and replaced rarely.
+
+		readers:
+			auto guard = domain.read();
+			const table* t = published.load(std::memory_order_acquire);
+			... use t until guard goes out of scope
+		writer:
+			const table* old = published.exchange(newTable);
+			domain.synchronize();	// no reader uses old anymore
+			delete old;
+
+		every thread has its own cache line slot, indexed by detail::threadIndex,
+		entering and leaving a read section are two plain stores to that slot and one fence,
+		so readers never write a line that another thread writes.
+		the slot counter is odd while its thread is inside a read section,
+		synchronize() waits until every slot that was odd has changed.
+		threads beyond maxReaders share two counters, one per parity of an epoch,
+		synchronize() drains the inactive counter (late readers of an older epoch), flips the epoch
+		and drains the counter of the old parity, new readers count on the other one,
+		so a stream of readers can't starve the writer.
+
+		read sections must not nest and must not call synchronize().
+	*/
+	class rcu_domain final
+	{
+	public:
+		static constexpr size_t maxReaders = 128;
+
+		class read_guard final
+		{
+		public:
+			~read_guard()
+			{
+				if (_slot != nullptr)
+					_slot->store(_slot->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+				else
+					_overflow->fetch_sub(1, std::memory_order_release);
+			}
+
+		private:
+			friend class rcu_domain;
+			explicit read_guard(rcu_domain& d)
+			{
+				const size_t i = detail::threadIndex::get();
+				if (i < maxReaders)
+				{
+					_slot = &d._slots[i];
+					_slot->store(_slot->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in synchronize
+				}
+				else
+				{
+					// a reader that counts on a parity after it was flipped is drained by the next synchronize
+					_overflow = &d._overflow.readers[d._overflow.epoch.load() & 1];
+					_overflow->fetch_add(1);
+				}
+			}
+
+			std::atomic<uint64_t>* _slot{ nullptr };
+			std::atomic<size_t>* _overflow{ nullptr };
+
+			read_guard(const read_guard&) = delete;
+			read_guard& operator=(const read_guard&) = delete;
+		};
+
+		rcu_domain() = default;
+
+		read_guard read() { return read_guard{ *this }; }
+
+		// blocking, returns after every read section that started before the call has ended
+		void synchronize()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst); // the new data is visible before the slots are read
+
+			for (auto& slot : _slots)
+			{
+				const uint64_t seq = slot.load(std::memory_order_acquire);
+				if ((seq & 1) == 0)
+					continue;
+				while (slot.load(std::memory_order_acquire) == seq)
+					std::this_thread::yield();
+			}
+
+			std::lock_guard<std::mutex> lock(_syncMtx);
+			const size_t current = _overflow.epoch.load() & 1;
+			drain(_overflow.readers[current ^ 1]);
+			_overflow.epoch.fetch_add(1);
+			drain(_overflow.readers[current]);
+		}
+
+	private:
+		static void drain(const std::atomic<size_t>& readers)
+		{
+			while (readers.load(std::memory_order_acquire) != 0)
+				std::this_thread::yield();
+		}
+
+		struct overflowReaders
+		{
+			std::atomic<size_t> epoch{ 0 };
+			std::atomic<size_t> readers[2]{};
+		};
+
+		cacheAligned<std::atomic<uint64_t>> _slots[maxReaders]{};
+		cacheAligned<overflowReaders> _overflow;
+		std::mutex _syncMtx;	// one epoch flip at a time
+
+		static_assert(sizeof(cacheAligned<std::atomic<uint64_t>>) == cacheLineSize, "a reader slot must be alone on its cache line");
+
+		rcu_domain(const rcu_domain&) = delete;
+		rcu_domain& operator=(const rcu_domain&) = delete;
+	};
+}
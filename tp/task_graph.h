@@ -0,0 +1,327 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <condition_variable>
+
+#include "unique_function.h"
+#include "threadpool.h"
+
+namespace concurency
+{
+	/*
+		a DAG of tasks run on a threadPool, no task waits for another one:
+
+		task_graph g;
+		auto extract = g.add([]() { ... });
+		auto clean = g.add([]() { ... }, 10);	// cost, relative to the other nodes
+		auto load = g.add([]() { ... });
+		g.precede(extract, clean);	// clean runs after extract
+		g.precede(clean, load);
+		g.run(tp);
+
+		every node keeps an atomic counter of the predecessors that did not finish,
+		the worker that brings it to 0 posts the node right away.
+		the edges are kept in flat arrays built on the first run after a change, a run only resets the counters,
+		the graph can be run again and again without allocating.
+
+		critical path first: the rank of a node is its cost plus the highest rank of its successors.
+		the nodes that become ready together are posted by rank, in a pool with priorityLevels > 1 the rank also picks the level,
+		the most critical nodes get level 0.
+
+		an exception thrown by a node skips the nodes that did not start yet, wait() rethrows the first one.
+		a node made ready after its pool ended runs on the thread that made it ready.
+	*/
+	class task_graph final
+	{
+	public:
+		typedef size_t node_t;
+
+		task_graph() = default;
+		~task_graph() { waitIdle(); }
+
+		// func is any callable like void func(), a returned value is ignored
+		template<typename F>
+		node_t add(F&& func, uint64_t cost = 1);
+		// after runs when before finished, std::invalid_argument for an unknown node or before == after
+		void precede(node_t before, node_t after);
+
+		size_t size()const { return _nodes.size(); }
+
+		/*
+			posts the nodes without predecessors and returns, wait() blocks until all nodes ran.
+			std::invalid_argument if the graph has a cycle, std::logic_error if it is running or the pool is not.
+			run() blocks the calling thread, not a worker, it must not be a worker of pool.
+		*/
+		template<typename Pool_t>
+		void start(Pool_t& pool);
+		void wait();
+		template<typename Pool_t>
+		void run(Pool_t& pool)
+		{
+			start(pool);
+			wait();
+		}
+
+		// cost of the longest path from node to the end of the graph, valid after start(), saturates at UINT64_MAX
+		uint64_t rank(node_t node)const { return _rank.at(node); }
+
+	private:
+		struct node
+		{
+			unique_function<void()> func;
+			uint64_t cost;
+		};
+
+		void build();
+		void finish();
+		void waitIdle();
+		void lockedIdle(std::unique_lock<std::mutex>& lock) { _cond.wait(lock, [this]() { return !_running; }); }
+		template<typename Pool_t>
+		void execute(Pool_t& pool, node_t n);
+		template<typename Pool_t>
+		void post(Pool_t& pool, node_t n);	// the level of a node follows its rank
+		template<typename Pool_t>
+		void postOrRun(Pool_t& pool, node_t n);
+
+		std::vector<node> _nodes;
+		std::vector<std::pair<node_t, node_t>> _edges;	// as added, turned into _successors by build()
+		bool _built{ false };
+
+		// built once per change of the graph
+		std::vector<size_t> _offsets;		// successors of n are _successors[_offsets[n], _offsets[n + 1]), by rank
+		std::vector<node_t> _successors;
+		std::vector<node_t> _roots;			// by rank
+		std::vector<uint32_t> _predecessors;
+		std::vector<uint64_t> _rank;
+		uint64_t _maxRank{ 0 };
+		std::unique_ptr<std::atomic<uint32_t>[]> _pending;	// predecessors not finished in this run
+
+		// this run
+		cacheAligned<std::atomic<size_t>> _remaining{ 0 };
+		std::atomic<bool> _failed{ false };
+		std::exception_ptr _error;	// written once, by the one that set _failed
+
+		std::mutex _mtx;
+		std::condition_variable _cond;
+		bool _running{ false };	// guarded by _mtx
+
+		task_graph(const task_graph&) = delete;
+		task_graph& operator=(const task_graph&) = delete;
+	};
+
+	template<typename F>
+	task_graph::node_t task_graph::add(F&& func, uint64_t cost)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		if (_running)
+			throw std::logic_error("task_graph is running");
+		_nodes.push_back({ unique_function<void()>{ [f = std::forward<F>(func)]() mutable { f(); } }, cost });
+		_built = false;
+		return _nodes.size() - 1;
+	}
+
+	inline void task_graph::precede(node_t before, node_t after)
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		if (_running)
+			throw std::logic_error("task_graph is running");
+		if (before >= _nodes.size() || after >= _nodes.size() || before == after)
+			throw std::invalid_argument("task_graph::precede needs two different nodes of the graph");
+		_edges.emplace_back(before, after);
+		_built = false;
+	}
+
+	template<typename Pool_t>
+	void task_graph::start(Pool_t& pool)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mtx);
+			if (_running)
+				throw std::logic_error("task_graph is running");
+			if (!_built)
+				build();
+			if (_nodes.empty())
+				return;
+
+			for (size_t n = 0; n < _nodes.size(); ++n)
+				_pending[n].store(_predecessors[n], std::memory_order_relaxed);
+			_remaining.store(_nodes.size());
+			_failed.store(false);
+			_error = nullptr;
+			_running = true;
+		}
+
+		// the first post tells if the pool runs, later ones fall back to the calling thread
+		try
+		{
+			post(pool, _roots.front());
+		}
+		catch (...)
+		{
+			finish();
+			throw;
+		}
+		for (size_t i = 1; i < _roots.size(); ++i)
+			postOrRun(pool, _roots[i]);
+	}
+
+	inline void task_graph::wait()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		lockedIdle(lock);
+		if (_failed.exchange(false))
+		{
+			std::exception_ptr error = std::move(_error);
+			_error = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	inline void task_graph::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		lockedIdle(lock);
+	}
+
+	// called with _mtx held
+	inline void task_graph::build()
+	{
+		const size_t n = _nodes.size();
+		_predecessors.assign(n, 0);
+		_offsets.assign(n + 1, 0);
+		for (const auto& e : _edges)
+		{
+			++_offsets[e.first + 1];
+			++_predecessors[e.second];
+		}
+		for (size_t i = 0; i < n; ++i)
+			_offsets[i + 1] += _offsets[i];
+		_successors.resize(_edges.size());
+		{
+			std::vector<size_t> fill(_offsets.begin(), _offsets.end() - 1);
+			for (const auto& e : _edges)
+				_successors[fill[e.first]++] = e.second;
+		}
+
+		// topological order (Kahn), ranks from the end backwards
+		std::vector<node_t> order;
+		order.reserve(n);
+		{
+			std::vector<uint32_t> left(_predecessors);
+			for (node_t i = 0; i < n; ++i)
+			{
+				if (left[i] == 0)
+					order.push_back(i);
+			}
+			for (size_t k = 0; k < order.size(); ++k)
+			{
+				const node_t v = order[k];
+				for (size_t s = _offsets[v]; s < _offsets[v + 1]; ++s)
+				{
+					if (--left[_successors[s]] == 0)
+						order.push_back(_successors[s]);
+				}
+			}
+		}
+		if (order.size() != n)
+			throw std::invalid_argument("task_graph has a cycle");
+
+		_rank.assign(n, 0);
+		_maxRank = 0;
+		for (auto it = order.rbegin(); it != order.rend(); ++it)
+		{
+			const node_t v = *it;
+			uint64_t longest{ 0 };
+			for (size_t s = _offsets[v]; s < _offsets[v + 1]; ++s)
+				longest = std::max(longest, _rank[_successors[s]]);
+			// saturates, a path too long for uint64_t is simply the longest
+			const uint64_t cost = _nodes[v].cost;
+			_rank[v] = longest > std::numeric_limits<uint64_t>::max() - cost ? std::numeric_limits<uint64_t>::max() : cost + longest;
+			_maxRank = std::max(_maxRank, _rank[v]);
+		}
+
+		auto byRank = [this](node_t a, node_t b) { return _rank[a] > _rank[b]; };
+		for (node_t v = 0; v < n; ++v)
+			std::stable_sort(_successors.begin() + static_cast<std::ptrdiff_t>(_offsets[v]), _successors.begin() + static_cast<std::ptrdiff_t>(_offsets[v + 1]), byRank);
+		_roots.clear();
+		for (node_t v = 0; v < n; ++v)
+		{
+			if (_predecessors[v] == 0)
+				_roots.push_back(v);
+		}
+		std::stable_sort(_roots.begin(), _roots.end(), byRank);
+
+		_pending.reset(new std::atomic<uint32_t>[n]);
+		_built = true;
+	}
+
+	inline void task_graph::finish()
+	{
+		// notified under the lock, a waiter that wakes up may destroy the graph
+		std::lock_guard<std::mutex> lock(_mtx);
+		_running = false;
+		_cond.notify_all();
+	}
+
+	template<typename Pool_t>
+	void task_graph::execute(Pool_t& pool, node_t n)
+	{
+		if (!_failed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				_nodes[n].func();
+			}
+			catch (...)
+			{
+				if (!_failed.exchange(true))
+					_error = std::current_exception();
+			}
+		}
+		for (size_t s = _offsets[n]; s < _offsets[n + 1]; ++s)
+		{
+			const node_t next = _successors[s];
+			if (_pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				postOrRun(pool, next);
+		}
+		if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			finish();
+	}
+
+	template<typename Pool_t>
+	void task_graph::post(Pool_t& pool, node_t n)
+	{
+		auto f = [this, &pool, n]() { execute(pool, n); };
+		if constexpr (Pool_t::priorityLevels > 1)
+		{
+			// (_maxRank - rank) * levels / (_maxRank + 1) overflows uint64_t for large costs
+			const long double behind = static_cast<long double>(_maxRank - _rank[n]);
+			const auto level = static_cast<size_t>(behind * Pool_t::priorityLevels / (static_cast<long double>(_maxRank) + 1));
+			pool.post(f, priority{ std::min(level, Pool_t::priorityLevels - 1) });
+		}
+		else
+			pool.post(f);
+	}
+
+	template<typename Pool_t>
+	void task_graph::postOrRun(Pool_t& pool, node_t n)
+	{
+		try
+		{
+			post(pool, n);
+		}
+		catch (std::logic_error&)
+		{
+			execute(pool, n); // the pool ended
+		}
+	}
+}
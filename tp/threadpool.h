@@ -2,20 +2,146 @@
 
 #include <thread>
 #include <vector>
+#include <deque>
+#include <memory>
 #include <future>
-#include <random>
 #include <limits>
 #include <iostream>
-#include <shared_mutex>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
 
 #include "threadsafe_queue.h"
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
+#include "block_pool.h"
+#include "unique_function.h"
+#include "placement.h"
+#include "mapping.h"
+#include "rcu.h"
+#include "metrics.h"
+#include "lane_queue.h"
+#include "deadline_queue.h"
+#include "timer_wheel.h"
+#include "pool_future.h"
+#include "topology.h"
 
 namespace concurency
 {
-	void setAffinity(int cpuNum);
+	// pins the calling thread to a cpu or to a set of cpus, it may move between them
+	inline void setAffinity(int cpuNum);
+	inline void setAffinity(const std::vector<int>& cpus);
 
 	/*
-		executes functions that look like this: Ret_t func()
+		Ret_t of a threadPool that runs tasks of any return type on one set of workers and queues,
+		push(func) returns std::future<std::invoke_result_t<F>>, submit(func) a pool_future of it:
+
+		concurency::threadPool<concurency::anyResult> tp;
+		std::future<bool> b = tp.push([]() { return true; });
+		std::future<void> v = tp.push([]() {});
+
+		the queues hold type erased tasks anyway, a task costs the same as in a pool of its own return type.
+	*/
+	struct anyResult final {};
+
+	namespace detail
+	{
+		// the value of the future of a task F pushed to a threadPool<Ret_t>
+		template<typename Ret_t, typename F>
+		struct resultOf { typedef Ret_t type; };
+		template<typename F>
+		struct resultOf<anyResult, F> { typedef std::invoke_result_t<std::decay_t<F>&> type; };
+		template<typename Ret_t, typename F>
+		using result_t = typename resultOf<Ret_t, F>::type;
+		template<typename Ret_t, typename It>
+		using bulkResult_t = result_t<Ret_t, typename std::iterator_traits<It>::value_type>;
+
+		// the size of [first, last) when it can be walked twice, 0 for a single pass input iterator
+		template<typename It>
+		size_t sizeHint(It first, It last)
+		{
+			if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>)
+				return static_cast<size_t>(std::distance(first, last));
+			else
+				return 0;
+		}
+
+		// a queue declares multiConsumer = false when only one thread may pop from it
+		template<typename Queue_t, typename = void>
+		struct isMultiConsumer : std::true_type {};
+		template<typename Queue_t>
+		struct isMultiConsumer<Queue_t, std::void_t<decltype(Queue_t::multiConsumer)>> : std::bool_constant<Queue_t::multiConsumer> {};
+
+		template<typename Queue_t, typename T, typename = void>
+		struct hasPushBulk : std::false_type {};
+		template<typename Queue_t, typename T>
+		struct hasPushBulk<Queue_t, T, std::void_t<decltype(std::declval<Queue_t&>().try_push_bulk(std::declval<T*>(), size_t()))>> : std::true_type {};
+
+		// queues without try_push_bulk get one try_push per item
+		template<typename Queue_t, typename T>
+		size_t tryPushBulk(Queue_t& queue, T* items, size_t count)
+		{
+			if constexpr (hasPushBulk<Queue_t, T>::value)
+				return queue.try_push_bulk(items, count);
+			else
+			{
+				size_t pushed{ 0 };
+				while (pushed < count && queue.try_push(std::move(items[pushed])))
+					++pushed;
+				return pushed;
+			}
+		}
+	}
+
+	/*
+		how tasks pushed without a hash are handled
+
+		random       - a task stays in the queue of a random worker until that worker gets to it
+		workStealing - a task is placed on a random worker, an idle worker steals it from its siblings.
+		               tasks pushed with a hash are never stolen, they keep their order.
+	*/
+	enum class schedulingMode
+	{
+		random,
+		workStealing
+	};
+
+	/*
+		what a worker does when its queues are empty, before it parks on its condition_variable
+
+		spinIterations  - polls of the queues with a cpu pause in between, lowest wake up latency, keeps the core busy
+		yieldIterations - polls with std::this_thread::yield in between, gives the core to other threads
+		then it parks, a pusher notifies only parked workers, so while workers spin or yield pushers don't notify at all.
+	*/
+	struct waitStrategy
+	{
+		size_t spinIterations{ 0 };
+		size_t yieldIterations{ 0 };
+
+		static constexpr waitStrategy park() { return { 0, 0 }; }
+		static constexpr waitStrategy spinThenPark() { return { 4096, 64 }; }
+	};
+
+	/*
+		priority of a task in a threadPool with numPriorities > 1,
+		level 0 is the highest, numPriorities - 1 the lowest, tasks pushed without one get numPriorities / 2.
+		tp.push(func, priority{ 0 }), tp.post(func, hash, priority{ 2 })
+	*/
+	struct priority
+	{
+		size_t level;
+	};
+
+	// the exception in the future of a task pushed with push_with_deadline that was dropped because its deadline passed
+	class deadlineMissed final : public std::runtime_error
+	{
+	public:
+		deadlineMissed() : std::runtime_error("the deadline of the task passed before it started") {}
+	};
+
+	/*
+		executes functions that look like this: Ret_t func(), any return type with Ret_t = anyResult
 		
 		example:
 		concurency::threadPool<bool> tp_t;
@@ -31,24 +157,72 @@ namespace concurency
 		job2 ----> queue 2 -> thread2
 		job3 ----> queue 3 -> thread3
 
+		every worker has a second queue for unhashed tasks and pops from both in turn,
+		in schedulingMode::workStealing a worker that has nothing to do takes tasks from the second queue of its siblings.
+		in schedulingMode::random a single consumer Queue_t keeps unhashed tasks in the queue of the hashed ones.
+
+		Queue_t is the per worker queue, any queue with try_push/try_pop/size/empty,
+		threadsafe_queue (mutex + deque), mpmc_queue (lock free, bounded) or
+		mpsc_queue (lock free, only the owning worker pops, no allocation after warm up).
+		when a bounded queue is full the pusher yields until there is room, a worker of the pool doesn't wait,
+		the room may have to come from itself: its tasks go to an unbounded overflow list of the destination worker,
+		which moves them back to its queue in order before it pops. while that list holds tasks every push goes to it.
+		a single consumer queue can't be stolen from, in schedulingMode::workStealing
+		the stealable queue falls back to threadsafe_queue.
+
+		Placement_t picks the worker for a task without a hash, see placement.h:
+		randomPlacement (default), roundRobinPlacement, powerOfTwoPlacement, leastLoadedPlacement.
+
+		Mapping_t maps the hash of a task to a worker, see mapping.h:
+		moduloMapping (default), jumpHashMapping, rendezvousMapping,
+		the consistent ones keep most keys on their worker when the number of workers changes.
+
+		Metrics_t switches the instrumentation at compile time, see metrics.h:
+		noMetrics (default, costs nothing), poolMetrics<timeEvery> (counters and latency histograms, see stats()).
+
+		numPriorities is the number of priority levels, every queue of a worker becomes a lane per level (lane_queue.h).
+		a worker drains the higher lanes first by weighted round robin, so a flood of high priority tasks
+		does not starve the lower ones. tasks of one key with the same priority keep their order.
+		with numPriorities = 1 (default) there are no lanes and no cost.
+
+		push_with_deadline() schedules earliest deadline first, every worker keeps a heap of the tasks with a deadline
+		and runs them before its lanes, a task without a deadline is due at infinity.
+		a task whose deadline passed is dropped instead of run, see push_with_deadline().
+
+		waitStrategy tells an idle worker how long to spin and yield before it parks.
+
+		a task is queued as a move only unique_function that holds the callable and its std::promise,
+		the promise shared state comes from block_pool, so small tasks don't touch the heap after warm up.
+
 		the max number of thread is fixed to avoid resizing of internal vector of workers,
 		if push() happens before start() or after end() an std::logic_error exception maybe thrown.
 		all API functions are 100% thread safe.
+		pushers don't lock anything to see the running workers, start() publishes an immutable worker table,
+		end() unpublishes it and waits for a grace period of an rcu_domain (rcu.h) before it stops the workers.
+		resize() adds or retires workers while the pool keeps running, see resize().
 	*/
-	template<typename Ret_t, size_t maxNumThreads = 128>
+	template<typename Ret_t, size_t maxNumThreads = 128, template<typename> class Queue_t = threadsafe_queue, typename Placement_t = randomPlacement, typename Mapping_t = moduloMapping, typename Metrics_t = noMetrics, size_t numPriorities = 1>
 	class threadPool final
 	{
+		static_assert(numPriorities >= 1 && numPriorities <= 16, "numPriorities must be between 1 and 16");
+
 	public:
 		typedef std::function<Ret_t()> task_t;
 
-		threadPool()
+		explicit threadPool(schedulingMode mode = schedulingMode::random, waitStrategy wait = waitStrategy::park())
+			: _workers(maxNumThreads), _mode(mode), _wait(wait), _executor(std::make_shared<detail::executorToken>(this, &threadPool::postLocal))
+		{}
+		~threadPool()
 		{
-			_workers.resize(maxNumThreads);
+			end();
+			_executor->retire(); // pool_futures may outlive the pool
 		}
-		~threadPool() { end(); }
 
 		size_t threadNum()const { return _threadNum.load(); }
 		constexpr size_t maxThreadNum()const { return maxNumThreads; }
+		static constexpr size_t priorityLevels = numPriorities;
+		static constexpr priority defaultPriority{ numPriorities / 2 };
+		schedulingMode mode()const { return _mode; }
 
 		/*
 			start(5) - starts 5 threads
@@ -58,6 +232,14 @@ namespace concurency
 		*/
 		void start(size_t numThreads);
 		void start(const std::vector<int>& affinity);
+		/*
+			a worker per entry of spec, on its cpus, see affinity_spec (topology.h):
+			start(affinity_spec::parse("node:0,1")) - a worker per cpu of nodes 0 and 1, grouped by node
+			in schedulingMode::workStealing a worker steals from its own node first, a task pushed to a worker
+			wakes a parked worker of the same node first. workers added by resize() are not pinned.
+			a worker builds its queues once it is pinned, they come from its node.
+		*/
+		void start(const affinity_spec& spec);
 		
 		/*
 			blocking
@@ -65,38 +247,420 @@ namespace concurency
 		*/
 		void end(); // finishes all the threads and cleans the task queues
 
-		// returns future return of the func, so caller can wait for it or just ignore it
-		std::future<Ret_t> push(task_t&& func); // random thread will handle it
-		std::future<Ret_t> push(task_t&& func, uint32_t hash); // a specific thread will handle it, equal hashes will be passed to the same thread
+		/*
+			blocking, changes the number of workers of a running pool, pushers are never rejected or blocked.
+			new workers start before they get tasks, retired workers run everything they got before they exit.
+			hashed tasks keep their order per key and priority: tasks of a key that moved to another worker are held back
+			until every old worker ran the hashed tasks it got before the resize, then they are released in order.
+			resize() returns after that, it does not wait for unhashed tasks
+			(except with a single consumer Queue_t in schedulingMode::random, there they share a queue with hashed tasks).
+			must not be called from a task of this pool.
+		*/
+		void resize(size_t numThreads);
+
+		/*
+			a snapshot of the running workers for monitoring and autoscaling (autoscaler.h).
+			queued - tasks waiting in the queues of the worker
+			idle   - total time the worker spent parked, it keeps growing over start/end/resize
+			the numbers of different workers are not taken at the same instant.
+		*/
+		struct workerLoad
+		{
+			size_t queued;
+			std::chrono::nanoseconds idle;
+		};
+		std::vector<workerLoad> load()const;
+
+		/*
+			counters and wait/run histograms of the running workers, only with Metrics_t = poolMetrics<>.
+			workerStats::merge sums them up for the whole pool.
+		*/
+		std::vector<workerStats> stats()const;
+
+		/*
+			returns future return of the func, so caller can wait for it or just ignore it
+			func is any callable that looks like Ret_t func(), it is moved (or copied) into the queue once
+			with Ret_t = anyResult the future is of the return type of func, see anyResult
+		*/
+		template<typename F>
+		std::future<detail::result_t<Ret_t, F>> push(F&& func); // random thread will handle it
+		template<typename F>
+		std::future<detail::result_t<Ret_t, F>> push(F&& func, uint32_t hash); // a specific thread will handle it, equal hashes will be passed to the same thread
+
+		/*
+			the same with a priority level, see priority, std::invalid_argument if prio.level >= numPriorities.
+			tasks of one hash keep their order only within one level.
+		*/
+		template<typename F>
+		std::future<detail::result_t<Ret_t, F>> push(F&& func, priority prio);
+		template<typename F>
+		std::future<detail::result_t<Ret_t, F>> push(F&& func, uint32_t hash, priority prio);
+
+		/*
+			waits for a future (std::future, std::shared_future or pool_future) without holding the worker.
+			called from a task of this pool, the worker runs other tasks meanwhile: its unhashed and deadline tasks,
+			in schedulingMode::workStealing also those of its siblings. hashed tasks are never run while waiting,
+			a task of the same key could be on the stack and their order would break.
+			a task that waits for a hashed task queued behind it on the same worker still never finishes,
+			so do unhashed tasks queued with a single consumer Queue_t, they share the queue of the hashed ones.
+			called from any other thread it is f.wait().
+			get(f) is wait(f) and f.get()
+		*/
+		template<typename Future>
+		void wait(Future& f);
+		template<typename Future>
+		auto get(Future& f) -> decltype(f.get())
+		{
+			wait(f);
+			return f.get();
+		}
+
+		/*
+			like push(), the pool_future (pool_future.h) can chain the next step with then() instead of blocking,
+			a continuation is queued to the worker that finished its predecessor.
+		*/
+		template<typename F>
+		pool_future<detail::result_t<Ret_t, F>> submit(F&& func);
+		template<typename F>
+		pool_future<detail::result_t<Ret_t, F>> submit(F&& func, uint32_t hash);
+
+		/*
+			fire and forget, no promise or future is created, the return value of func is ignored.
+			an exception thrown by func is passed to the exception handler.
+		*/
+		template<typename F>
+		void post(F&& func); // random thread will handle it
+		template<typename F>
+		void post(F&& func, uint32_t hash); // same as push(func, hash)
+		template<typename F>
+		void post(F&& func, priority prio);
+		template<typename F>
+		void post(F&& func, uint32_t hash, priority prio);
+
+		/*
+			called from the worker thread for every exception that escapes a posted task,
+			the default handler prints it to std::cerr. the handler should not throw.
+		*/
+		typedef std::function<void(std::exception_ptr)> exceptionHandler_t;
+		void setExceptionHandler(exceptionHandler_t handler);
+
+		/*
+			pushes the callables in [first, last) in one pass, *first is a callable like in push().
+			any input iterator, a forward iterator lets the vectors be sized up front.
+			the tasks get defaultPriority.
+			without a hash the tasks are split in consecutive chunks between the workers,
+			a worker queue is locked once per batch and only the workers that got tasks are woken up.
+			hashOf(*it) returns the hash of a task, tasks with equal hashes keep their order.
+			the futures are in the order of the tasks.
+			use std::make_move_iterator to move the callables out of the range.
+		*/
+		template<typename It>
+		std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> push_bulk(It first, It last);
+		template<typename It, typename Hash>
+		std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> push_bulk(It first, It last, Hash&& hashOf);
+
+		// same as push_bulk without futures, see post()
+		template<typename It>
+		void post_bulk(It first, It last);
+		template<typename It, typename Hash>
+		void post_bulk(It first, It last, Hash&& hashOf);
+
+		/*
+			a task that is useless after deadline, the worker picked by Placement_t runs it before everything
+			without a deadline, the earliest deadline first. in schedulingMode::workStealing an idle sibling may take it.
+			if the deadline passed before the task starts it is dropped: func is not called and the future throws deadlineMissed,
+			a task that is already late when it is pushed is not queued at all.
+			post_with_deadline() drops it silently. both count it in missedDeadlines(), and in stats() of the worker
+			that dropped it, or that pushed it when it was late already. std::logic_error when the pool is not running.
+		*/
+		typedef std::chrono::steady_clock::time_point time_point;
+		template<typename F>
+		std::future<detail::result_t<Ret_t, F>> push_with_deadline(F&& func, time_point deadline);
+		template<typename F>
+		void post_with_deadline(F&& func, time_point deadline);
+
+		// tasks dropped because their deadline passed, since the pool was created
+		uint64_t missedDeadlines()const { return _missedDeadlines.load(std::memory_order_relaxed); }
+
+		/*
+			delayed and periodic tasks, kept in a hierarchical timing wheel (timer_wheel.h) with a resolution of timerTick.
+			one tick thread per pool, started by the first timer, sleeps until the next timer is due and posts it (see post()).
+			schedule_after(delay, func)  - func runs once after delay, rounded up to whole ticks
+			schedule_every(period, func) - func runs every period, the first time after one period.
+			                               a period that comes while the previous run has not finished is skipped, runs never overlap.
+			adding and cancelling (timerHandle::cancel) a timer is O(1).
+			std::logic_error if the pool is not running, end() drops the pending timers.
+		*/
+		static constexpr std::chrono::milliseconds timerTick{ 1 };
+		template<typename Rep, typename Period, typename F>
+		timerHandle schedule_after(std::chrono::duration<Rep, Period> delay, F&& func);
+		template<typename Rep, typename Period, typename F>
+		timerHandle schedule_every(std::chrono::duration<Rep, Period> period, F&& func);
+
+		/*
+			C++20 coroutines, co_await tp.schedule() resumes the coroutine on a worker, co_await tp.schedule_on(hash)
+			on the worker of hash, after the tasks queued there before it. see coro.h for task<T>.
+			the resume is posted like post(), the handle fits unique_function inline, nothing is allocated.
+			std::logic_error out of co_await if the pool is not running.
+			the awaitable takes any handle type, this header stays C++17.
+		*/
+		class scheduleAwaitable final
+		{
+		public:
+			explicit scheduleAwaitable(threadPool& pool) : _pool(pool), _hashed(false), _hash(0) {}
+			scheduleAwaitable(threadPool& pool, uint32_t hash) : _pool(pool), _hashed(true), _hash(hash) {}
+
+			bool await_ready()const noexcept { return false; }
+			template<typename Handle>
+			void await_suspend(Handle h)
+			{
+				if (_hashed)
+					_pool.post([h]() mutable { h.resume(); }, _hash);
+				else
+					_pool.post([h]() mutable { h.resume(); });
+			}
+			void await_resume()const noexcept {}
+
+		private:
+			threadPool& _pool;
+			const bool _hashed;
+			const uint32_t _hash;
+		};
+		scheduleAwaitable schedule() { return scheduleAwaitable{ *this }; }
+		scheduleAwaitable schedule_on(uint32_t hash) { return scheduleAwaitable{ *this, hash }; }
 
 	private:
+		typedef unique_function<void()> runnable_t;	// what the workers execute
+
+		template<typename F, typename R>
+		runnable_t package(F&& func, std::future<R>& future);
+		template<typename F>
+		runnable_t package(F&& func);
+		template<typename F, typename R>
+		runnable_t packageDeadline(F&& func, time_point deadline, std::future<R>& future);
+		template<typename F>
+		runnable_t packageDeadline(F&& func, time_point deadline);
+		template<typename F, typename R>
+		static void fulfill(F& func, std::promise<R>& promise);
+		void missed();
+		void onException(std::exception_ptr ex)const;
+
+		void dispatch(runnable_t&& r, priority prio, bool local = false);	// local - to the calling worker if it is one of this pool
+		void dispatch(runnable_t&& r, uint32_t hash, priority prio);
+		static bool postLocal(void* pool, unique_function<void()>& task);	// detail::executorToken::post
+		static size_t laneOf(priority prio);
+		void dispatchBulk(std::vector<runnable_t>& r);
+		void dispatchBulk(std::vector<runnable_t>& r, const std::vector<uint32_t>& hashes);
+		void dispatchDeadline(runnable_t&& r, time_point deadline);
+
+		typedef std::shared_ptr<detail::timerState> timer_t;
+		timerHandle addTimer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period, runnable_t&& task);
+		void runTimers();
+		void fire(timer_t&& timer);
+		void stopTimers();
+		size_t pickWorker(size_t numWorkers);
 
-		struct worker final
+		struct alignas(cacheLineSize) worker final
 		{
-			worker(int affinity = -1) :_affinity(affinity) {}
-			worker(worker&&) noexcept = default;
-			worker& operator=(worker&& rHnd) noexcept = default;
+			worker() = default;
 
-			void setCpuAffinity(int a) { _affinity = a; }
+			void setCpuAffinity(int a) { setCpuAffinity(a >= 0 ? std::vector<int>{ a } : std::vector<int>(), -1); }
+			void setCpuAffinity(std::vector<int> cpus, int node)
+			{
+				_cpus = std::move(cpus);
+				_node.store(node, std::memory_order_relaxed);
+			}
+			int node()const { return _node.load(std::memory_order_relaxed); }	// -1 when not on one node
 
-			void start(std::atomic<bool>& end);
+			void start(threadPool& pool, size_t index);
 			void end();
+			void retire();	// the pool doesn't push to it anymore, runs what is queued and exits
+
+			// lane is the priority level
+			void push(runnable_t* r, size_t count, size_t lane);				// only this worker will execute them
+			bool pushStealable(runnable_t* r, size_t count, size_t lane);	// an idle sibling may execute them
+			void pushUnhashed(runnable_t* r, size_t count, size_t lane);		// schedulingMode::random without a hash
+			bool pushDeadline(runnable_t&& r, time_point deadline);			// a sibling may steal it
+
+			bool trySteal(runnable_t& out) { return popped(_queues->deadlines.try_pop(out) || _queues->stealable.try_pop_highest(out)); }
+			bool help(threadPool& pool, size_t index);	// runs one task for a task of this worker that waits, see threadPool::wait
+			bool hasStealable()const { return !_queues->deadlines.empty() || !_queues->stealable.empty(); }
+			bool parked()const { return _parked.load(); }
+			bool wake();	// false when it was woken already and not yet running
 
-			std::future<Ret_t> push(task_t&& t);
+			// tasks queued on this worker, counted only when Placement_t uses it
+			size_t depth()const { return _queued.load(std::memory_order_relaxed); }
+			size_t queued()const { return _queues->deadlines.size() + _queues->queue.size() + _queues->stealable.size() + _overflowNum.load(std::memory_order_relaxed); }
+			std::chrono::nanoseconds idle()const;
+			const typename Metrics_t::workerCounters& metrics()const { return _metrics; }
 
 		private:
-			threadsafe_queue<std::packaged_task<Ret_t()>> _queue;
+			// tasks with a deadline first, then _round picks the lane,
+			// within a lane the queues take turns, a stream of tasks in one of them doesn't starve the other
+			bool tryPop(runnable_t& out)
+			{
+				if (_overflowNum.load(std::memory_order_relaxed) != 0)
+					drainOverflow();
+				if (_queues->deadlines.try_pop(out))
+					return popped(true);
+				return popped(_round.next(_queues->queue.lanes() | _queues->stealable.lanes(), [this, &out](size_t lane) {
+					_hashedFirst = !_hashedFirst;
+					if (_hashedFirst)
+						return _queues->queue.try_pop(lane, out) || _queues->stealable.try_pop(lane, out);
+					return _queues->stealable.try_pop(lane, out) || _queues->queue.try_pop(lane, out);
+				}));
+			}
+			bool popped(bool res)
+			{
+				if constexpr (Placement_t::usesDepth)
+				{
+					if (res)
+						_queued.fetch_sub(1, std::memory_order_relaxed);
+				}
+				return res;
+			}
+			void park(threadPool& pool, size_t index);
+			// true when the push woke the parked worker, pushStealable and pushDeadline return it
+			template<typename Q>
+			bool push(Q& queue, runnable_t* r, size_t count, size_t lane);
+			void drainOverflow();
+
+			typedef Queue_t<runnable_t> queue_t;
+			typedef std::conditional_t<detail::isMultiConsumer<queue_t>::value, queue_t, threadsafe_queue<runnable_t>> stealQueue_t;
+			typedef lane_queue<queue_t, numPriorities> lanes_t;
+			typedef lane_queue<stealQueue_t, numPriorities> stealLanes_t;
+
+			// written by pushers, thieves and the worker, every queue starts on its own cache line
+			// unhashed tasks are kept out of queue, resize() then waits only for hashed tasks.
+			// in schedulingMode::random a single consumer queue_t is not replaced by threadsafe_queue, they share queue
+			struct queues
+			{
+				alignas(cacheLineSize) lanes_t queue;				// hashed tasks
+				alignas(cacheLineSize) stealLanes_t stealable;	// unhashed tasks
+				alignas(cacheLineSize) deadline_queue<runnable_t> deadlines;	// unhashed tasks with a deadline
+			};
+			// built by the worker thread once it is pinned, the first touch puts the queues on its node.
+			// built again only when the worker starts on another node, then the old ones are kept
+			// in _oldQueues until the pool is destroyed, load() may still read them
+			std::unique_ptr<queues> _queues;
+			alignas(cacheLineSize) std::atomic<size_t> _queued{ 0 };
+
+			// tasks a worker of the pool pushed while a bounded queue was full, in push order.
+			// while it is not empty every push goes behind it, tasks of one key keep their order
+			struct overflowTask
+			{
+				bool stealable;	// for stealable, else queue
+				size_t lane;
+				runnable_t task;
+			};
+			alignas(cacheLineSize) std::atomic<size_t> _overflowNum{ 0 };
+			std::mutex _overflowMtx;
+			std::deque<overflowTask> _overflow;	// guarded by _overflowMtx
+
+			// read by pushers, written by the worker when it parks
+			alignas(cacheLineSize) std::atomic<bool> _parked{ false };
+			std::atomic<bool> _retire{ false };
+			std::atomic<int64_t> _parkedSince{ 0 };	// steady_clock ns, 0 when not parked
+			std::atomic<int64_t> _idleNs{ 0 };		// total time parked
+			std::atomic<int> _node{ -1 };			// read by thieves, written only by start/resize
+			bool _signaled{ false };		// guarded by _parkMtx
+			std::mutex _parkMtx;
+			std::condition_variable _parkCond;
+
+			// touched only by start/end and the worker thread
 			std::thread _thread;
-			int _affinity{ -1 };
+			std::vector<int> _cpus;	// empty when not pinned
+			int _queuesNode{ -1 };	// the node _queues was built on
+			std::vector<std::unique_ptr<queues>> _oldQueues;
+			bool _hashedFirst{ false };
+			weighted_round<numPriorities> _round;
+			typename Metrics_t::workerCounters _metrics;	// written only by the worker thread
 
 			worker(const worker&) = delete;
 			worker& operator=(const worker&) = delete;
 		};
 
+		// workers are next to each other in _workers, the hot state of one must not share a line with its neighbour
+		static_assert(alignof(worker) == cacheLineSize, "worker must be cache line aligned");
+		static_assert(sizeof(worker) % cacheLineSize == 0, "worker must be padded to whole cache lines");
+
+		// the running workers, immutable once published, freed by end() after no pusher can see it
+		struct workerTable final
+		{
+			size_t size;
+			worker* workers;
+			size_t prevSize;	// != 0 while resize() holds back the hashed tasks of keys that moved
+
+			size_t workerFor(uint32_t hash)const { return Mapping_t::map(hash, size); }
+			bool moved(uint32_t hash)const { return prevSize != 0 && Mapping_t::map(hash, prevSize) != workerFor(hash); }
+		};
+
+		// hashed tasks of keys that moved, held until the old workers ran the tasks they got before resize()
+		struct movedTasks final
+		{
+			struct task_t
+			{
+				size_t worker;	// destination
+				size_t lane;
+				runnable_t task;
+			};
+
+			std::mutex mtx;
+			bool held{ false };
+			std::vector<task_t> tasks;
+		};
+
+		void publish(const workerTable* table);
+		bool holdMoved(const workerTable& table, uint32_t hash, size_t lane, runnable_t& r);
+
+		bool steal(size_t thief, runnable_t& out);
+		bool hasStealable(size_t thief)const;
+		void wakeParked(size_t from);
+
+		// the pool and index of the worker running on this thread, set by worker::start
+		struct currentWorker
+		{
+			const threadPool* pool;
+			size_t index;
+		};
+		static inline thread_local currentWorker _current{ nullptr, 0 };
+		static constexpr std::chrono::microseconds helpPoll{ 100 };	// a waiting worker that found nothing looks again after this
+
+		// read by every pusher, written only by start/end, they can share one line
+		alignas(cacheLineSize) std::atomic<const workerTable*> _table{ nullptr };	// read inside a read section of _rcu
 		std::atomic<size_t> _threadNum{0};	// number of current active workers
-		std::vector<worker> _workers;
 		std::atomic<bool> _end{ true };		// a flag for all workers
-		std::shared_mutex _mtx;				// used to sync start/end and pushers
+		std::vector<worker> _workers;
+		const schedulingMode _mode;
+		const waitStrategy _wait;
+		const std::shared_ptr<detail::executorToken> _executor;	// shared with the pool_futures of submit()
+
+		// every pusher writes only its own slot of _rcu, workers write _parkedNum on its own line
+		rcu_domain _rcu;
+		cacheAligned<std::atomic<size_t>> _parkedNum{ 0 };	// number of workers waiting for a task
+		cacheAligned<std::atomic<uint64_t>> _missedDeadlines{ 0 };	// written only when a task is dropped
+
+		std::mutex _startEndMtx;	// serializes start/end/resize
+
+		// the timers and their tick thread, everything but thread is guarded by mtx
+		struct timerService final
+		{
+			std::mutex mtx;
+			std::condition_variable cond;
+			timer_wheel<timer_t> wheel;
+			std::chrono::steady_clock::time_point origin;	// tick 0 of wheel
+			uint64_t wakeAt{ 0 };	// the tick the thread sleeps until, a timer due earlier must wake it
+			bool running{ false };	// the pool accepts timers
+			bool stop{ false };
+			std::thread thread;
+		};
+		timerService _timers;
+		movedTasks _moved;
+		std::shared_ptr<const exceptionHandler_t> _exceptionHandler;	// accessed with std::atomic_load/store
+		Placement_t _placement;
+
+		static_assert(alignof(cacheAligned<std::atomic<size_t>>) == cacheLineSize && sizeof(cacheAligned<std::atomic<size_t>>) == cacheLineSize,
+			"_parkedNum must be alone on its cache line");
 
 		threadPool(const threadPool&) = delete;
 		threadPool(const threadPool&&) = delete;
@@ -104,48 +668,299 @@ namespace concurency
 		threadPool& operator=(const threadPool&&) = delete;
 	};
 
-	template<typename Ret_t, size_t maxNumThreads>
-	void threadPool<Ret_t, maxNumThreads>::worker::start(std::atomic<bool>& endFlag)
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::start(threadPool& pool, size_t index)
 	{
-		auto f = [this, &endFlag]() {
-			if (_affinity >= 0)
-				setAffinity(_affinity);
-			while (!endFlag.load())
+		std::promise<void> built;
+		std::future<void> ready = built.get_future();
+		auto f = [this, &pool, index, built = std::move(built)]() mutable {
+			// pinned before the thread allocates anything, its stack, its queues and its block_pool caches come from its node
+			if (!_cpus.empty())
+				setAffinity(_cpus);
+			const int node = _node.load(std::memory_order_relaxed);
+			detail::poolNode = node >= 0 ? static_cast<size_t>(node) % detail::maxPoolNodes : 0;
+			if (_queues == nullptr || (node >= 0 && node != _queuesNode))
 			{
-				auto task = std::move(_queue.pop_front());
-				task();
+				if (_queues != nullptr)
+					_oldQueues.push_back(std::move(_queues));
+				_queues.reset(new queues);
+				_queuesNode = node;
 			}
+			built.set_value();
+			_metrics.setCurrent(&pool);
+			_current = { &pool, index };
+
+			const size_t spinUntil = pool._wait.spinIterations;
+			const size_t yieldUntil = spinUntil + pool._wait.yieldIterations;
+			size_t idle{ 0 };	// polls since the last task
 
-			while (!_queue.empty())
+			runnable_t task;
+			while (true)
 			{
-				auto task = std::move(_queue.pop_front());
-				task();
-			}
+				const bool local = tryPop(task);
+				if (local || pool.steal(index, task))
+				{
+					if (!local)
+						_metrics.stolen();
+					_metrics.executed();
+					task();
+					task = nullptr; // release whatever the task captured before waiting for the next one
+					idle = 0;
+					continue;
+				}
+
+				if (pool._end.load() || _retire.load())
+				{
+					// no pusher can reach this worker once _end or _retire is set, nothing can be added after this drain
+					while (tryPop(task))
+					{
+						_metrics.executed();
+						task();
+					}
+					task = nullptr;
+					break;
+				}
 
+				if (idle < spinUntil)
+					cpuRelax();
+				else if (idle < yieldUntil)
+					std::this_thread::yield();
+				else
+				{
+					park(pool, index);
+					idle = 0;
+					continue;
+				}
+				++idle;
+			}
 		};
 		end();
-		_thread = std::thread{ f };
+		_thread = std::thread{ std::move(f) };
+		ready.wait();	// the pool pushes to the worker as soon as start returns
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::help(threadPool& pool, size_t index)
+	{
+		// the queues thieves take from, nothing in them belongs to a key
+		runnable_t task;
+		const bool local = trySteal(task);
+		if (!local && !pool.steal(index, task))
+			return false;
+		if (!local)
+			_metrics.stolen();
+		_metrics.executed();
+		task();
+		return true;
 	}
-	template<typename Ret_t, size_t maxNumThreads>
-	void threadPool<Ret_t, maxNumThreads>::worker::end()
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::end()
 	{
 		if (_thread.joinable())
 		{
-			_queue.push_back(std::packaged_task<Ret_t()>([]() {return Ret_t(); }));
+			wake();
 			_thread.join();
 		}
 	}
-	template<typename Ret_t, size_t maxNumThreads>
-	std::future<Ret_t> threadPool<Ret_t, maxNumThreads>::worker::push(task_t&& t)
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::retire()
 	{
-		auto pt = std::packaged_task<Ret_t()>(t);
-		auto future = pt.get_future();
-		_queue.push_back(std::move(pt));
-		return future;
+		_retire.store(true);
+		end();
+		_retire.store(false);
 	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::park(threadPool& pool, size_t index)
+	{
+		const int64_t since = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		_parkedSince.store(since, std::memory_order_relaxed);
+
+		std::unique_lock<std::mutex> lock(_parkMtx);
+		_parked.store(true);
+		pool._parkedNum.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in push
+
+		// check again after announcing, a pusher that did not see _parked has already made its task visible
+		if (_queues->queue.empty() && _queues->stealable.empty() && _queues->deadlines.empty() && _overflowNum.load() == 0 && !pool.hasStealable(index) && !pool._end.load() && !_retire.load())
+		{
+			_metrics.parked();
+			_parkCond.wait(lock, [this]() { return _signaled; });
+		}
 
-	template<typename Ret_t, size_t maxNumThreads>
-	void threadPool<Ret_t, maxNumThreads>::start(size_t numThreads)
+		_signaled = false;
+		pool._parkedNum.fetch_sub(1);
+		_parked.store(false);
+		lock.unlock();
+
+		const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		_idleNs.fetch_add(now - since, std::memory_order_relaxed);
+		_parkedSince.store(0, std::memory_order_relaxed);
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	std::chrono::nanoseconds threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::idle()const
+	{
+		// a worker that is parked now counts the time since it parked
+		int64_t idleNs = _idleNs.load(std::memory_order_relaxed);
+		const int64_t since = _parkedSince.load(std::memory_order_relaxed);
+		if (since != 0)
+		{
+			const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			idleNs += std::max<int64_t>(0, now - since);
+		}
+		return std::chrono::nanoseconds{ idleNs };
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::wake()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_parkMtx);
+			if (_signaled)
+				return false;
+			_signaled = true;
+		}
+		_parkCond.notify_one();
+		return true;
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::push(runnable_t* r, size_t count, size_t lane)
+	{
+		push(_queues->queue, r, count, lane);
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::pushStealable(runnable_t* r, size_t count, size_t lane)
+	{
+		return push(_queues->stealable, r, count, lane);
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::pushUnhashed(runnable_t* r, size_t count, size_t lane)
+	{
+		if constexpr (std::is_same_v<stealQueue_t, queue_t>)
+			push(_queues->stealable, r, count, lane);
+		else
+			push(_queues->queue, r, count, lane);
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::pushDeadline(runnable_t&& r, time_point deadline)
+	{
+		if constexpr (Placement_t::usesDepth)
+			_queued.fetch_add(1, std::memory_order_relaxed);
+
+		_queues->deadlines.push(std::move(r), deadline);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst); // the task is visible before _parked is read
+		return _parked.load() && wake();
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename Q>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::push(Q& queue, runnable_t* r, size_t count, size_t lane)
+	{
+		if constexpr (Placement_t::usesDepth)
+			_queued.fetch_add(count, std::memory_order_relaxed);
+
+		// while the overflow list holds tasks every push goes behind them, a task that went to the queue
+		// would overtake older ones of its key (or the barrier of resize() would).
+		// a worker doesn't wait for room, the worker that makes it may be itself or waiting for it
+		const bool fromWorker = _current.pool != nullptr;
+		size_t pushed{ 0 };
+		while (_overflowNum.load() == 0)
+		{
+			pushed += detail::tryPushBulk(queue.lane(lane), r + pushed, count - pushed);
+			if (pushed == count || fromWorker)
+				break;
+			std::this_thread::yield(); // bounded queue is full, wait for the worker to make room
+		}
+		if (pushed < count)
+		{
+			const bool stealable = static_cast<const void*>(&queue) == static_cast<const void*>(&_queues->stealable);
+			std::lock_guard<std::mutex> lock(_overflowMtx);
+			for (; pushed < count; ++pushed)
+				_overflow.push_back({ stealable, lane, std::move(r[pushed]) });
+			_overflowNum.store(_overflow.size());
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst); // the task is visible before _parked and the lane bits are read
+		queue.pushed(lane);
+		return _parked.load() && wake();
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::worker::drainOverflow()
+	{
+		// stops at the first task that doesn't fit, the ones behind it wait for it
+		std::lock_guard<std::mutex> lock(_overflowMtx);
+		while (!_overflow.empty())
+		{
+			auto& o = _overflow.front();
+			const bool moved = o.stealable ? detail::tryPushBulk(_queues->stealable.lane(o.lane), &o.task, 1) == 1 : detail::tryPushBulk(_queues->queue.lane(o.lane), &o.task, 1) == 1;
+			if (!moved)
+				break;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (o.stealable)
+				_queues->stealable.pushed(o.lane);
+			else
+				_queues->queue.pushed(o.lane);
+			_overflow.pop_front();
+			_overflowNum.store(_overflow.size());
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::steal(size_t thief, runnable_t& out)
+	{
+		if (_mode != schedulingMode::workStealing)
+			return false;
+
+		// the siblings on the node of the thief first, a remote task costs remote memory accesses
+		const size_t n{ threadNum() };
+		const int node = _workers[thief].node();
+		for (size_t i = 1; i < n; ++i)
+		{
+			auto& w = _workers[(thief + i) % n];
+			if (w.node() == node && w.trySteal(out))
+				return true;
+		}
+		for (size_t i = 1; i < n; ++i)
+		{
+			auto& w = _workers[(thief + i) % n];
+			if (w.node() != node && w.trySteal(out))
+				return true;
+		}
+		return false;
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::hasStealable(size_t thief)const
+	{
+		if (_mode != schedulingMode::workStealing)
+			return false;
+
+		const size_t n{ threadNum() };
+		for (size_t i = 1; i < n; ++i)
+		{
+			if (_workers[(thief + i) % n].hasStealable())
+				return true;
+		}
+		return false;
+	}
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::wakeParked(size_t from)
+	{
+		if (_parkedNum.load() == 0)
+			return;
+
+		// a worker of the same node steals the task first, wake one of them if there is one
+		const size_t n{ threadNum() };
+		const int node = _workers[from].node();
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (size_t i = 1; i < n; ++i)
+			{
+				auto& w = _workers[(from + i) % n];
+				if ((w.node() == node) == (pass == 0) && w.parked() && w.wake())
+					return;
+			}
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::start(size_t numThreads)
 	{
 		if (numThreads == 0)
 			throw std::invalid_argument("numThreads can't be 0");
@@ -156,30 +971,64 @@ namespace concurency
 		start(affinity);
 	}
 
-	template<typename Ret_t, size_t maxNumThreads>
-	void threadPool<Ret_t, maxNumThreads>::start(const std::vector<int>& affinity)
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::start(const std::vector<int>& affinity)
 	{
 		if (affinity.size() == 0)
 			throw std::invalid_argument("requested numThreads can't be 0");
 		if (affinity.size() > maxNumThreads)
 			throw std::invalid_argument("requested numThreads can't be greater than maxNumThreads");
 
-		std::lock_guard<std::shared_mutex> lock(_mtx);
+		std::lock_guard<std::mutex> lock(_startEndMtx);
 
 		_end.store(false);
 		for (size_t i = 0; i < affinity.size(); ++i)
 		{
 			auto& w = _workers[i];
 			w.setCpuAffinity(affinity[i]);
-			w.start(_end);
+			w.start(*this, i);
 		}
 		_threadNum.store(affinity.size());
+		publish(new workerTable{ affinity.size(), _workers.data(), 0 });
+
+		std::lock_guard<std::mutex> timersLock(_timers.mtx);
+		_timers.running = true;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::start(const affinity_spec& spec)
+	{
+		if (spec.size() == 0)
+			throw std::invalid_argument("requested numThreads can't be 0");
+		if (spec.size() > maxNumThreads)
+			throw std::invalid_argument("requested numThreads can't be greater than maxNumThreads");
+
+		std::lock_guard<std::mutex> lock(_startEndMtx);
+
+		_end.store(false);
+		for (size_t i = 0; i < spec.size(); ++i)
+		{
+			auto& w = _workers[i];
+			w.setCpuAffinity(spec[i].cpus, spec[i].node);
+			w.start(*this, i);
+		}
+		_threadNum.store(spec.size());
+		publish(new workerTable{ spec.size(), _workers.data(), 0 });
+
+		std::lock_guard<std::mutex> timersLock(_timers.mtx);
+		_timers.running = true;
 	}
 
-	template<typename Ret_t, size_t maxNumThreads>
-	void threadPool<Ret_t, maxNumThreads>::end()
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::end()
 	{
-		std::lock_guard<std::shared_mutex> lock(_mtx);
+		std::lock_guard<std::mutex> lock(_startEndMtx);
+
+		// the tick thread posts, it stops first
+		stopTimers();
+
+		// after the grace period no pusher holds the table, nothing can be added after the workers drain
+		publish(nullptr);
 
 		const size_t threadNum = _threadNum.exchange(0);
 		_end.store(true);
@@ -187,26 +1036,757 @@ namespace concurency
 			_workers[i].end();
 	}
 
-	template<typename Ret_t, size_t maxNumThreads>
-	std::future<Ret_t> threadPool<Ret_t, maxNumThreads>::push(task_t&& t)
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::resize(size_t numThreads)
 	{
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_int_distribution<uint32_t> distrib(0, std::numeric_limits<uint32_t>::max());
+		if (numThreads == 0)
+			throw std::invalid_argument("numThreads can't be 0");
+		if (numThreads > maxNumThreads)
+			throw std::invalid_argument("requested numThreads can't be greater than maxNumThreads");
+
+		std::lock_guard<std::mutex> lock(_startEndMtx);
+
+		const workerTable* current = _table.load();
+		if (current == nullptr)
+			throw std::logic_error("resize of a pool that is not running");
+		const size_t oldNum = current->size;
+		if (numThreads == oldNum)
+			return;
+
+		for (size_t i = oldNum; i < numThreads; ++i)
+		{
+			auto& w = _workers[i];
+			w.setCpuAffinity(-1);
+			w.start(*this, i);
+		}
+
+		{
+			std::lock_guard<std::mutex> movedLock(_moved.mtx);
+			_moved.held = true;
+		}
+		publish(new workerTable{ numThreads, _workers.data(), oldNum });
+		_threadNum.store(numThreads);
+
+		// after the grace period the old workers got every task of the old mapping,
+		// a barrier at the end of each hashed queue tells when they ran them all.
+		// a consistent mapping that shrinks moves keys only from the retired workers, every lane gets its own barrier
+		const size_t firstLoser = Mapping_t::consistent && numThreads < oldNum ? numThreads : 0;
+		std::mutex barrierMtx;
+		std::condition_variable barrierCond;
+		size_t pending{ (oldNum - firstLoser) * numPriorities };
+		for (size_t i = firstLoser; i < oldNum; ++i)
+		{
+			for (size_t lane = 0; lane < numPriorities; ++lane)
+			{
+				runnable_t barrier{ [&barrierMtx, &barrierCond, &pending]() {
+					std::lock_guard<std::mutex> barrierLock(barrierMtx);
+					if (--pending == 0)
+						barrierCond.notify_one();
+				} };
+				_workers[i].push(&barrier, 1, lane);
+			}
+		}
+		{
+			std::unique_lock<std::mutex> barrierLock(barrierMtx);
+			barrierCond.wait(barrierLock, [&pending]() { return pending == 0; });
+		}
+
+		{
+			std::lock_guard<std::mutex> movedLock(_moved.mtx);
+			for (auto& held : _moved.tasks)
+				_workers[held.worker].push(&held.task, 1, held.lane);
+			_moved.tasks.clear();
+			_moved.held = false;
+		}
+		publish(new workerTable{ numThreads, _workers.data(), 0 });
 
-		return push(std::forward<task_t>(t), distrib(gen));
+		for (size_t i = numThreads; i < oldNum; ++i)
+			_workers[i].retire();
 	}
 
-	template<typename Ret_t, size_t maxNumThreads>
-	std::future<Ret_t> threadPool<Ret_t, maxNumThreads>::push(task_t&& t, uint32_t hash)
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	std::vector<typename threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::workerLoad> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::load()const
 	{
-		// multiple pushers can enter, they will wait only when start/end is called
-		std::shared_lock<std::shared_mutex> sharedLock(_mtx);
+		// the workers and their queues live as long as the pool, reading them without a table is safe
+		const size_t n{ threadNum() };
+		std::vector<workerLoad> res;
+		res.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			res.push_back({ _workers[i].queued(), _workers[i].idle() });
+		return res;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	std::vector<workerStats> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::stats()const
+	{
+		static_assert(Metrics_t::enabled, "stats() needs Metrics_t = poolMetrics<>");
 
 		const size_t n{ threadNum() };
-		if (n == 0)
+		std::vector<workerStats> res;
+		res.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			res.push_back(_workers[i].metrics().snapshot());
+			res.back().queued = _workers[i].queued();
+		}
+		return res;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::publish(const workerTable* table)
+	{
+		const workerTable* old = _table.exchange(table);
+		if (old != nullptr)
+		{
+			_rcu.synchronize();
+			delete old;
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::holdMoved(const workerTable& table, uint32_t hash, size_t lane, runnable_t& r)
+	{
+		if (!table.moved(hash))
+			return false;
+
+		// released tasks were pushed before held is cleared, a task pushed after it comes after them
+		std::lock_guard<std::mutex> lock(_moved.mtx);
+		if (!_moved.held)
+			return false;
+		_moved.tasks.push_back({ table.workerFor(hash), lane, std::move(r) });
+		return true;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	std::future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push(F&& func)
+	{
+		std::future<detail::result_t<Ret_t, F>> future;
+		dispatch(package(std::forward<F>(func), future), defaultPriority);
+		return future;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	std::future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push(F&& func, uint32_t hash)
+	{
+		std::future<detail::result_t<Ret_t, F>> future;
+		dispatch(package(std::forward<F>(func), future), hash, defaultPriority);
+		return future;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	std::future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push(F&& func, priority prio)
+	{
+		std::future<detail::result_t<Ret_t, F>> future;
+		dispatch(package(std::forward<F>(func), future), prio);
+		return future;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	std::future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push(F&& func, uint32_t hash, priority prio)
+	{
+		std::future<detail::result_t<Ret_t, F>> future;
+		dispatch(package(std::forward<F>(func), future), hash, prio);
+		return future;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename Future>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::wait(Future& f)
+	{
+		if (_current.pool != this)
+		{
+			f.wait();
+			return;
+		}
+
+		// like the worker loop, spin and yield first, then sleep in short slices, a new task doesn't wake a waiting worker
+		worker& self = _workers[_current.index];
+		const size_t spinUntil = _wait.spinIterations;
+		const size_t yieldUntil = spinUntil + _wait.yieldIterations;
+		size_t idle{ 0 };
+		while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (self.help(*this, _current.index))
+			{
+				idle = 0;
+				continue;
+			}
+			if (idle < spinUntil)
+				cpuRelax();
+			else if (idle < yieldUntil)
+				std::this_thread::yield();
+			else
+				f.wait_for(helpPoll);
+			++idle;
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	pool_future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::submit(F&& func)
+	{
+		auto state = std::make_shared<detail::futureState<detail::result_t<Ret_t, F>>>(detail::executorRef{ _executor });
+		dispatch(package([f = std::forward<F>(func), state]() mutable { detail::fulfill(*state, f); }), defaultPriority);
+		return pool_future<detail::result_t<Ret_t, F>>{ std::move(state) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	pool_future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::submit(F&& func, uint32_t hash)
+	{
+		auto state = std::make_shared<detail::futureState<detail::result_t<Ret_t, F>>>(detail::executorRef{ _executor });
+		dispatch(package([f = std::forward<F>(func), state]() mutable { detail::fulfill(*state, f); }), hash, defaultPriority);
+		return pool_future<detail::result_t<Ret_t, F>>{ std::move(state) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	bool threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::postLocal(void* pool, unique_function<void()>& task)
+	{
+		threadPool& self = *static_cast<threadPool*>(pool);
+		runnable_t r = self.package(std::move(task));
+		try
+		{
+			self.dispatch(std::move(r), defaultPriority, true);
+			return true;
+		}
+		catch (std::logic_error&)
+		{
+			// the pool ended, dispatch throws before it takes r, the caller runs it outside the lock of the token
+			task = std::move(r);
+			return false;
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F, typename R>
+	typename threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::runnable_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::package(F&& func, std::future<R>& future)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+
+		std::promise<R> promise{ std::allocator_arg, pool_allocator<R>() };
+		future = promise.get_future();
+		return runnable_t{ Metrics_t::timed([f = std::forward<F>(func), p = std::move(promise)]() mutable {
+			fulfill(f, p);
+		}, this) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F, typename R>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::fulfill(F& func, std::promise<R>& promise)
+	{
+		try
+		{
+			if constexpr (std::is_void_v<R>)
+			{
+				func();
+				promise.set_value();
+			}
+			else
+				promise.set_value(func());
+		}
+		catch (...)
+		{
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F, typename R>
+	typename threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::runnable_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::packageDeadline(F&& func, time_point deadline, std::future<R>& future)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+
+		std::promise<R> promise{ std::allocator_arg, pool_allocator<R>() };
+		future = promise.get_future();
+		return runnable_t{ Metrics_t::timed([f = std::forward<F>(func), p = std::move(promise), deadline, this]() mutable {
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				missed();
+				p.set_exception(std::make_exception_ptr(deadlineMissed{}));
+				return;
+			}
+			fulfill(f, p);
+		}, this) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	typename threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::runnable_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::packageDeadline(F&& func, time_point deadline)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+
+		return runnable_t{ Metrics_t::timed([f = std::forward<F>(func), deadline, this]() mutable {
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				missed();
+				return;
+			}
+			try
+			{
+				f();
+			}
+			catch (...)
+			{
+				onException(std::current_exception());
+			}
+		}, this) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::missed()
+	{
+		Metrics_t::missed(this);
+		_missedDeadlines.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	std::future<detail::result_t<Ret_t, F>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push_with_deadline(F&& func, time_point deadline)
+	{
+		typedef detail::result_t<Ret_t, F> result_t;
+		std::future<result_t> future;
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			// late already, not worth a queue slot
+			if (_table.load(std::memory_order_acquire) == nullptr)
+				throw std::logic_error("no available workers");
+			std::promise<result_t> promise{ std::allocator_arg, pool_allocator<result_t>() };
+			future = promise.get_future();
+			promise.set_exception(std::make_exception_ptr(deadlineMissed{}));
+			missed();
+			return future;
+		}
+		dispatchDeadline(packageDeadline(std::forward<F>(func), deadline, future), deadline);
+		return future;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post_with_deadline(F&& func, time_point deadline)
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			if (_table.load(std::memory_order_acquire) == nullptr)
+				throw std::logic_error("no available workers");
+			missed();
+			return;
+		}
+		dispatchDeadline(packageDeadline(std::forward<F>(func), deadline), deadline);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post(F&& func)
+	{
+		dispatch(package(std::forward<F>(func)), defaultPriority);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post(F&& func, uint32_t hash)
+	{
+		dispatch(package(std::forward<F>(func)), hash, defaultPriority);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post(F&& func, priority prio)
+	{
+		dispatch(package(std::forward<F>(func)), prio);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post(F&& func, uint32_t hash, priority prio)
+	{
+		dispatch(package(std::forward<F>(func)), hash, prio);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename F>
+	typename threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::runnable_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::package(F&& func)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+
+		return runnable_t{ Metrics_t::timed([f = std::forward<F>(func), this]() mutable {
+			try
+			{
+				f();
+			}
+			catch (...)
+			{
+				onException(std::current_exception());
+			}
+		}, this) };
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::setExceptionHandler(exceptionHandler_t handler)
+	{
+		std::atomic_store(&_exceptionHandler, std::shared_ptr<const exceptionHandler_t>(
+			handler ? std::make_shared<const exceptionHandler_t>(std::move(handler)) : nullptr));
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::onException(std::exception_ptr ex)const
+	{
+		auto handler = std::atomic_load(&_exceptionHandler);
+		if (handler)
+		{
+			try
+			{
+				(*handler)(ex);
+			}
+			catch (...)
+			{
+				// the worker thread must survive a throwing handler
+			}
+			return;
+		}
+
+		try
+		{
+			std::rethrow_exception(ex);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "threadPool: exception in a posted task: " << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << "threadPool: unknown exception in a posted task" << std::endl;
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	size_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::laneOf(priority prio)
+	{
+		if (prio.level >= numPriorities)
+			throw std::invalid_argument("priority level must be less than numPriorities");
+		return prio.level;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::dispatch(runnable_t&& r, priority prio, bool local)
+	{
+		const size_t lane = laneOf(prio);
+		auto guard = _rcu.read();
+		const workerTable* table = _table.load(std::memory_order_acquire);
+		if (table == nullptr)
+			throw std::logic_error("no available workers");
+
+		// a retiring worker is not in the table anymore
+		const bool here = local && _current.pool == this && _current.index < table->size;
+		const size_t index = here ? _current.index : pickWorker(table->size);
+		worker& w = table->workers[index];
+		if (_mode != schedulingMode::workStealing)
+		{
+			w.pushUnhashed(&r, 1, lane);
+			return;
+		}
+
+		// the chosen worker is busy, or woken already for an earlier task, let an idle one steal this one
+		if (!w.pushStealable(&r, 1, lane))
+			wakeParked(index);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::dispatch(runnable_t&& r, uint32_t hash, priority prio)
+	{
+		const size_t lane = laneOf(prio);
+
+		// multiple pushers can enter, start/end wait for them to leave
+		auto guard = _rcu.read();
+		const workerTable* table = _table.load(std::memory_order_acquire);
+		if (table == nullptr)
+			throw std::logic_error("no available workers");
+		if (!holdMoved(*table, hash, lane, r))
+			table->workers[table->workerFor(hash)].push(&r, 1, lane);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename It>
+	std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push_bulk(It first, It last)
+	{
+		const size_t count = detail::sizeHint(first, last);
+		std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> futures;
+		std::vector<runnable_t> runnables;
+		futures.reserve(count);
+		runnables.reserve(count);
+		for (; first != last; ++first)
+		{
+			futures.emplace_back();
+			runnables.push_back(package(*first, futures.back()));
+		}
+
+		dispatchBulk(runnables);
+		return futures;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename It, typename Hash>
+	std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::push_bulk(It first, It last, Hash&& hashOf)
+	{
+		const size_t count = detail::sizeHint(first, last);
+		std::vector<std::future<detail::bulkResult_t<Ret_t, It>>> futures;
+		std::vector<runnable_t> runnables;
+		std::vector<uint32_t> hashes;
+		futures.reserve(count);
+		runnables.reserve(count);
+		hashes.reserve(count);
+		for (; first != last; ++first)
+		{
+			hashes.push_back(static_cast<uint32_t>(hashOf(*first)));
+			futures.emplace_back();
+			runnables.push_back(package(*first, futures.back()));
+		}
+
+		dispatchBulk(runnables, hashes);
+		return futures;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename It>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post_bulk(It first, It last)
+	{
+		std::vector<runnable_t> runnables;
+		runnables.reserve(detail::sizeHint(first, last));
+		for (; first != last; ++first)
+			runnables.push_back(package(*first));
+
+		dispatchBulk(runnables);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename It, typename Hash>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::post_bulk(It first, It last, Hash&& hashOf)
+	{
+		const size_t count = detail::sizeHint(first, last);
+		std::vector<runnable_t> runnables;
+		std::vector<uint32_t> hashes;
+		runnables.reserve(count);
+		hashes.reserve(count);
+		for (; first != last; ++first)
+		{
+			hashes.push_back(static_cast<uint32_t>(hashOf(*first)));
+			runnables.push_back(package(*first));
+		}
+
+		dispatchBulk(runnables, hashes);
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::dispatchBulk(std::vector<runnable_t>& r)
+	{
+		if (r.empty())
+			return;
+
+		auto guard = _rcu.read();
+		const workerTable* table = _table.load(std::memory_order_acquire);
+		if (table == nullptr)
+			throw std::logic_error("no available workers");
+
+		// consecutive chunks, as equal as possible, one per worker starting from the one Placement_t picks
+		const size_t n{ table->size };
+		const size_t first = pickWorker(n);
+		const size_t chunks = std::min(n, r.size());
+		size_t offset{ 0 };
+		for (size_t i = 0; i < chunks; ++i)
+		{
+			const size_t count = r.size() / chunks + (i < r.size() % chunks ? 1 : 0);
+			auto& w = table->workers[(first + i) % n];
+			if (_mode == schedulingMode::workStealing)
+				w.pushStealable(r.data() + offset, count, defaultPriority.level);
+			else
+				w.pushUnhashed(r.data() + offset, count, defaultPriority.level);
+			offset += count;
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::dispatchBulk(std::vector<runnable_t>& r, const std::vector<uint32_t>& hashes)
+	{
+		if (r.empty())
+			return;
+
+		auto guard = _rcu.read();
+		const workerTable* table = _table.load(std::memory_order_acquire);
+		if (table == nullptr)
+			throw std::logic_error("no available workers");
+
+		const size_t n{ table->size };
+		std::vector<std::vector<runnable_t>> buckets(n);
+		for (size_t i = 0; i < r.size(); ++i)
+		{
+			if (!holdMoved(*table, hashes[i], defaultPriority.level, r[i]))
+				buckets[table->workerFor(hashes[i])].push_back(std::move(r[i]));
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (!buckets[i].empty())
+				table->workers[i].push(buckets[i].data(), buckets[i].size(), defaultPriority.level);
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::dispatchDeadline(runnable_t&& r, time_point deadline)
+	{
+		auto guard = _rcu.read();
+		const workerTable* table = _table.load(std::memory_order_acquire);
+		if (table == nullptr)
 			throw std::logic_error("no available workers");
-		return _workers[hash % n].push(std::forward<task_t>(t));
+
+		const size_t index = pickWorker(table->size);
+		worker& w = table->workers[index];
+		if (!w.pushDeadline(std::move(r), deadline) && _mode == schedulingMode::workStealing)
+			wakeParked(index); // the chosen worker is busy or woken already, let an idle one steal the task
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename Rep, typename Period, typename F>
+	timerHandle threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::schedule_after(std::chrono::duration<Rep, Period> delay, F&& func)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+		return addTimer(std::chrono::duration_cast<std::chrono::nanoseconds>(delay), std::chrono::nanoseconds{ 0 }, runnable_t{ [f = std::forward<F>(func)]() mutable { f(); } });
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	template<typename Rep, typename Period, typename F>
+	timerHandle threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::schedule_every(std::chrono::duration<Rep, Period> period, F&& func)
+	{
+		static_assert(std::is_invocable_v<std::decay_t<F>&>, "a task must be callable without arguments");
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(period);
+		if (ns < timerTick)
+			throw std::invalid_argument("the period of a timer can't be shorter than timerTick");
+		return addTimer(ns, ns, runnable_t{ [f = std::forward<F>(func)]() mutable { f(); } });
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	timerHandle threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::addTimer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period, runnable_t&& task)
+	{
+		const std::chrono::nanoseconds tick{ timerTick };
+		auto timer = std::make_shared<detail::timerState>();
+		timer->period = static_cast<uint64_t>(period.count() / tick.count());
+		timer->task = std::move(task);
+		timerHandle handle{ timer };
+
+		const auto now = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock(_timers.mtx);
+		if (!_timers.running)
+			throw std::logic_error("no available workers");
+		if (!_timers.thread.joinable())
+		{
+			_timers.origin = now;
+			_timers.stop = false;
+			_timers.wakeAt = timer_wheel<timer_t>::never;
+			_timers.thread = std::thread{ [this]() { runTimers(); } };
+		}
+
+		// rounded up, a timer never fires early
+		const auto fromOrigin = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _timers.origin) + std::max(delay, std::chrono::nanoseconds{ 0 });
+		const uint64_t at = static_cast<uint64_t>((fromOrigin.count() + tick.count() - 1) / tick.count());
+		_timers.wheel.add(at, std::move(timer));
+		if (at < _timers.wakeAt)
+		{
+			lock.unlock();
+			_timers.cond.notify_one();
+		}
+		return handle;
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::runTimers()
+	{
+		const std::chrono::nanoseconds tick{ timerTick };
+		std::vector<std::pair<uint64_t, timer_t>> due;	// tick, timer, fired outside the lock
+
+		std::unique_lock<std::mutex> lock(_timers.mtx);
+		while (!_timers.stop)
+		{
+			_timers.wakeAt = _timers.wheel.nextEvent();
+			if (_timers.wakeAt == timer_wheel<timer_t>::never)
+				_timers.cond.wait(lock);
+			else
+				_timers.cond.wait_until(lock, _timers.origin + tick * _timers.wakeAt);
+			if (_timers.stop)
+				break;
+
+			const auto now = std::chrono::steady_clock::now() - _timers.origin;
+			const uint64_t nowTick = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() / tick.count());
+			_timers.wheel.advance(nowTick, [&due](uint64_t at, timer_t&& timer) { due.emplace_back(at, std::move(timer)); });
+
+			// periodic timers go back in the wheel on their own schedule, periods missed by a late tick are skipped
+			for (const auto& [at, timer] : due)
+			{
+				if (timer->period != 0 && timer->status.load() == detail::timerState::pending)
+				{
+					const uint64_t periods = (nowTick - at) / timer->period + 1;
+					_timers.wheel.add(at + periods * timer->period, timer);
+				}
+			}
+
+			lock.unlock();
+			for (auto& [at, timer] : due)
+				fire(std::move(timer));
+			due.clear();
+			lock.lock();
+		}
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::fire(timer_t&& timer)
+	{
+		if (timer->period == 0)
+		{
+			int expected = detail::timerState::pending;
+			if (timer->status.compare_exchange_strong(expected, detail::timerState::fired))
+				post(std::move(timer->task));
+			return;
+		}
+
+		if (timer->status.load() != detail::timerState::pending || timer->running.exchange(true))
+			return; // cancelled, or the previous run has not finished
+		post([timer = std::move(timer)]() {
+			try
+			{
+				timer->task();
+			}
+			catch (...)
+			{
+				timer->running.store(false);
+				throw;
+			}
+			timer->running.store(false);
+		});
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	void threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::stopTimers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_timers.mtx);
+			_timers.running = false;
+			_timers.stop = true;
+		}
+		_timers.cond.notify_one();
+		if (_timers.thread.joinable())
+			_timers.thread.join();
+
+		std::lock_guard<std::mutex> lock(_timers.mtx);
+		_timers.wheel.clear([](timer_t&& timer) {
+			int expected = detail::timerState::pending;
+			timer->status.compare_exchange_strong(expected, detail::timerState::cancelled);
+		});
+	}
+
+	template<typename Ret_t, size_t maxNumThreads, template<typename> class Queue_t, typename Placement_t, typename Mapping_t, typename Metrics_t, size_t numPriorities>
+	size_t threadPool<Ret_t, maxNumThreads, Queue_t, Placement_t, Mapping_t, Metrics_t, numPriorities>::pickWorker(size_t numWorkers)
+	{
+		return _placement.pick(numWorkers, [this](size_t i) { return _workers[i].depth(); });
 	}
 }
 
@@ -223,21 +1803,36 @@ namespace concurency
 #warning "thread pinning is not supported for this OS"
 #endif
 
-void concurency::setAffinity(int cpuNum)
+inline void concurency::setAffinity(int cpuNum)
+{
+	setAffinity(std::vector<int>{ cpuNum });
+}
+
+inline void concurency::setAffinity(const std::vector<int>& cpus)
 {
 #if defined(_WIN32)
-	DWORD mask = (1 << cpuNum);
+	DWORD_PTR mask = 0;
+	for (int cpu : cpus)
+	{
+		if (cpu >= 0 && cpu < 64)
+			mask |= DWORD_PTR(1) << cpu;	// the first processor group only
+	}
 	HANDLE th = GetCurrentThread();
 	/*DWORD_PTR prev_mask =*/ SetThreadAffinityMask(th, mask);
 #elif defined (linux)
 	cpu_set_t cpuset;
 	CPU_ZERO(&cpuset);
-	CPU_SET(cpuNum, &cpuset);
+	for (int cpu : cpus)
+	{
+		if (cpu >= 0 && cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &cpuset);
+	}
 	int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 	if (rc != 0) {
 		std::cerr << "Error calling pthread_setaffinity_np: " << rc << std::endl;
 	}
 #else
+	(void)cpus;
 	std::cerr << "thread pinning is not supported for this OS" << std::endl;
 #endif
 }
\ No newline at end of file
@@ -23,6 +23,16 @@ namespace concurency
 		T& front();
 		T pop_front();
 		void pop_front(T& out);
+
+		// non blocking, returns false if the queue is empty
+		bool try_pop_front(T& out);
+
+		// same interface as the lock free queues, so threadPool can use any of them.
+		// they don't notify, threadPool workers park on their own condition variable,
+		// a thread blocked in front()/pop_front() is woken only by push_back()
+		bool try_push(T&& item);
+		bool try_pop(T& out) { return try_pop_front(out); }
+		size_t try_push_bulk(T* items, size_t count); // one lock for all the items, returns count
 		
 		void push_back(const T& item);
 		void push_back(T&& item);
@@ -112,6 +122,18 @@ namespace concurency
 		_queue.pop_front();
 	}
 
+	template <typename T>
+	bool threadsafe_queue<T>::try_pop_front(T& out)
+	{
+		std::unique_lock<std::mutex> mlock(_mutex);
+		if (_queue.empty())
+			return false;
+
+		out = std::move(_queue.front());
+		_queue.pop_front();
+		return true;
+	}
+
 	template <typename T>
 	void threadsafe_queue<T>::push_back(const T& item)
 	{
@@ -136,6 +158,23 @@ namespace concurency
 
 	}
 
+	template <typename T>
+	bool threadsafe_queue<T>::try_push(T&& item)
+	{
+		std::unique_lock<std::mutex> mlock(_mutex);
+		_queue.push_back(std::move(item));
+		return true;
+	}
+
+	template <typename T>
+	size_t threadsafe_queue<T>::try_push_bulk(T* items, size_t count)
+	{
+		std::unique_lock<std::mutex> mlock(_mutex);
+		for (size_t i = 0; i < count; ++i)
+			_queue.push_back(std::move(items[i]));
+		return count;
+	}
+
 	template <typename T>
 	size_t threadsafe_queue<T>::size()const
 	{
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "unique_function.h"
+
+namespace concurency
+{
+	/*
+		hierarchical timing wheel, no threads or clocks, time is counted in ticks.
+		numLevels wheels of 64 slots, level l holds the items due in [64^l, 64^(l+1)) ticks from now,
+		an item moves down one level when its slot of the higher wheel comes around (cascade).
+		items due later than 64^numLevels ticks wait in an overflow list that is sorted into the wheels
+		every time the top wheel turns.
+
+		add() is O(1), advance() costs O(1) per tick and per item that fires or moves down.
+		with 1ms ticks the wheels cover 12 days, further timers are rare and pay only for the overflow list.
+		not thread safe, threadPool guards it with a mutex.
+	*/
+	template<typename T, size_t numLevels = 5>
+	class timer_wheel final
+	{
+		static_assert(numLevels >= 1 && 6 * numLevels < 64, "timer_wheel supports 1 to 10 levels");
+
+	public:
+		static constexpr unsigned slotBits = 6;
+		static constexpr size_t numSlots = size_t{ 1 } << slotBits;
+		static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+		uint64_t now()const { return _now; }
+		size_t size()const { return _size; }
+		bool empty()const { return _size == 0; }
+
+		// due at tick at, an item that is already due fires on the next tick
+		void add(uint64_t at, T item)
+		{
+			place(std::max(at, _now + 1), std::move(item));
+			++_size;
+		}
+
+		/*
+			moves the wheel to tick now, expired(at, T&&) is called for every item due until then,
+			in the order of their ticks. ticks where nothing happens are skipped.
+		*/
+		template<typename F>
+		void advance(uint64_t now, F&& expired)
+		{
+			while (_now < now)
+			{
+				const uint64_t next = nextEvent();
+				if (next > now)
+				{
+					_now = now;
+					return;
+				}
+				_now = next;
+				process(expired);
+			}
+		}
+
+		// the next tick after now() at which an item fires or moves down, never when empty
+		uint64_t nextEvent()const
+		{
+			if (_size == 0)
+				return never;
+
+			uint64_t res = never;
+			for (size_t level = 0; level < numLevels; ++level)
+			{
+				const unsigned shift = slotBits * static_cast<unsigned>(level);
+				const uint64_t base = _now >> shift;
+				for (uint64_t k = 1; k <= numSlots; ++k)
+				{
+					if (!_wheels[level][(base + k) & (numSlots - 1)].empty())
+					{
+						res = std::min(res, (base + k) << shift);
+						break;
+					}
+				}
+			}
+			if (!_overflow.empty())
+				res = std::min(res, ((_now >> topShift) + 1) << topShift);
+			return res;
+		}
+
+		// removes every item, each(T&&) is called for them, the wheel goes back to tick 0
+		template<typename F>
+		void clear(F&& each)
+		{
+			for (auto& wheel : _wheels)
+				for (auto& slot : wheel)
+					drain(slot, each);
+			drain(_overflow, each);
+			_size = 0;
+			_now = 0;
+		}
+
+	private:
+		struct entry
+		{
+			uint64_t at;
+			T item;
+		};
+		typedef std::vector<entry> slot_t;
+
+		static constexpr unsigned topShift = slotBits * static_cast<unsigned>(numLevels - 1);
+
+		// at >= _now, an item due now goes to the slot of this tick, process() fires it
+		void place(uint64_t at, T&& item)
+		{
+			const uint64_t delta = at - _now;
+			for (size_t level = 0; level < numLevels; ++level)
+			{
+				const unsigned shift = slotBits * static_cast<unsigned>(level);
+				if (delta < (uint64_t{ 1 } << (shift + slotBits)))
+				{
+					_wheels[level][(at >> shift) & (numSlots - 1)].push_back({ at, std::move(item) });
+					return;
+				}
+			}
+			_overflow.push_back({ at, std::move(item) });
+		}
+
+		template<typename F>
+		void process(F& expired)
+		{
+			// from the top, an item that moves down may have to move down again on the same tick
+			if ((_now & ((uint64_t{ 1 } << topShift) - 1)) == 0 && !_overflow.empty())
+				cascade(_overflow);
+			for (size_t level = numLevels - 1; level > 0; --level)
+			{
+				const unsigned shift = slotBits * static_cast<unsigned>(level);
+				if ((_now & ((uint64_t{ 1 } << shift) - 1)) == 0)
+					cascade(_wheels[level][(_now >> shift) & (numSlots - 1)]);
+			}
+
+			slot_t& due = _wheels[0][_now & (numSlots - 1)];
+			if (due.empty())
+				return;
+			std::swap(due, _scratch);
+			_size -= _scratch.size();
+			for (auto& e : _scratch)
+				expired(e.at, std::move(e.item));
+			_scratch.clear();
+		}
+
+		void cascade(slot_t& slot)
+		{
+			if (slot.empty())
+				return;
+			std::swap(slot, _scratch);
+			for (auto& e : _scratch)
+				place(e.at, std::move(e.item));
+			_scratch.clear();
+		}
+
+		template<typename F>
+		static void drain(slot_t& slot, F& each)
+		{
+			for (auto& e : slot)
+				each(std::move(e.item));
+			slot.clear();
+		}
+
+		std::array<std::array<slot_t, numSlots>, numLevels> _wheels;
+		slot_t _overflow;
+		slot_t _scratch;	// the slot being fired or cascaded, keeps its capacity
+		uint64_t _now{ 0 };
+		size_t _size{ 0 };
+	};
+
+	namespace detail
+	{
+		// shared by a timer in the wheel and its timerHandle
+		struct timerState
+		{
+			enum : int { pending, fired, cancelled };
+
+			std::atomic<int> status{ pending };
+			std::atomic<bool> running{ false };	// a run of a periodic timer was posted and has not finished
+			uint64_t period{ 0 };				// ticks, 0 for a one shot timer
+			unique_function<void()> task;
+		};
+	}
+
+	/*
+		returned by threadPool::schedule_after and schedule_every, copyable.
+		cancel()  - the task won't be started anymore, a run that already started finishes.
+		            returns false if the timer already fired (one shot) or was cancelled before.
+		pending() - a one shot timer that has not fired, a periodic timer that is not cancelled.
+		a cancelled timer leaves the wheel when it would have fired.
+	*/
+	class timerHandle final
+	{
+	public:
+		timerHandle() = default;
+		explicit timerHandle(std::shared_ptr<detail::timerState> state) : _state(std::move(state)) {}
+
+		bool cancel()
+		{
+			if (!_state)
+				return false;
+			int expected = detail::timerState::pending;
+			return _state->status.compare_exchange_strong(expected, detail::timerState::cancelled);
+		}
+		bool pending()const
+		{
+			return _state && _state->status.load() == detail::timerState::pending;
+		}
+
+	private:
+		std::shared_ptr<detail::timerState> _state;
+	};
+}
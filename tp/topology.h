@@ -0,0 +1,383 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+namespace concurency
+{
+	/*
+		the cpus of the machine and their NUMA nodes, read from /sys/devices/system on linux:
+		cpu/online, node/online, node/nodeN/cpulist, cpu/cpuN/topology/{core_id,physical_package_id}
+		and cpu/cpuN/cache/indexK/{level,type,shared_cpu_list} for the last level cache.
+		without them (other OS, a container that hides /sys) all std::thread::hardware_concurrency() cpus are on node 0.
+
+		topology t = topology::discover();
+		t.nodes()			- number of nodes, a node id is an index, a node may have no cpus (memory only)
+		t.cpusOf(node)		- its cpus, ascending
+		t.nodeOf(cpu)		- -1 for a cpu that is not online
+		t.siblingsOf(cpu)	- the cpus of the same core (SMT), cpu included
+		t.cacheSiblingsOf(cpu)	- the cpus that share its last level cache, cpu included
+	*/
+	class topology final
+	{
+	public:
+		struct cpu
+		{
+			int id;
+			int node;
+			int core;		// core_id, unique within a package
+			int package;
+			int cache{ -1 };	// the lowest cpu that shares its last level cache, -1 when unknown
+		};
+
+		topology() = default;
+		// numNodes counts the nodes without cpus too, std::invalid_argument for a negative id or node
+		explicit topology(std::vector<cpu> cpus, size_t numNodes = 0);
+
+		// root is there for tests, a copy of the /sys tree
+		static topology discover(const std::string& root = "/sys/devices/system");
+
+		// "0-3,8,10-11" like in cpulist files and taskset, sorted and unique, std::invalid_argument when malformed
+		static std::vector<int> parseCpuList(const std::string& list);
+
+		size_t nodes()const { return _nodes.size(); }
+		const std::vector<int>& cpusOf(size_t node)const { return _nodes.at(node); }
+		int nodeOf(int cpuId)const;
+		std::vector<int> siblingsOf(int cpuId)const;
+		std::vector<int> cacheSiblingsOf(int cpuId)const;
+		const std::vector<cpu>& cpus()const { return _cpus; }
+
+	private:
+		const cpu* find(int cpuId)const;
+
+		std::vector<cpu> _cpus;	// by id
+		std::vector<std::vector<int>> _nodes;
+	};
+
+	/*
+		where the workers of a threadPool run, every worker gets a set of cpus and the node they are on:
+
+		affinity_spec spec;				// of topology::discover()
+		spec.addNode(0);				// a worker per cpu of node 0, each may run on any cpu of the node
+		spec.addNode(1, 4);				// 4 workers on node 1
+		spec.addCpus({ 2, 3 });			// a worker pinned to cpu 2 and one pinned to cpu 3
+		spec.addCpuSet({ 4, 5 }, 2);	// 2 workers that share cpus 4 and 5
+		tp.start(spec);
+
+		the same as text, entries separated by ';': affinity_spec::parse("node:0;node:1*4;cpu:2,3;set:4-5*2"),
+		node:0,1 adds the workers of both nodes, *N is the number of workers per node, or in the set.
+
+		a worker whose cpus span nodes belongs to none (-1). in schedulingMode::workStealing
+		an idle worker steals from the workers of its own node first, then from the others.
+		a worker pins itself before its thread allocates anything, then it builds its queues, by first touch they come
+		from its node like its stack, and it frees task memory to the block_pool lists of its node.
+		a worker started again on another node builds new queues.
+	*/
+	class affinity_spec final
+	{
+	public:
+		struct worker
+		{
+			std::vector<int> cpus;
+			int node;
+		};
+
+		explicit affinity_spec(topology topo = topology::discover())
+			: _topo(std::move(topo))
+		{}
+
+		// std::invalid_argument for an empty set, a negative cpu, a node without cpus or a count of 0
+		affinity_spec& addCpus(const std::vector<int>& cpus);
+		affinity_spec& addCpuSet(const std::vector<int>& cpus, size_t count);
+		affinity_spec& addNode(int node, size_t count = 0);	// 0 is a worker per cpu of the node
+		static affinity_spec parse(const std::string& spec, topology topo = topology::discover());
+
+		size_t size()const { return _workers.size(); }
+		const worker& operator[](size_t i)const { return _workers.at(i); }
+		const topology& topo()const { return _topo; }
+
+	private:
+		int nodeOf(const std::vector<int>& cpus)const;
+
+		topology _topo;
+		std::vector<worker> _workers;
+	};
+
+	namespace detail
+	{
+		inline bool readFirstLine(const std::string& path, std::string& line)
+		{
+			std::ifstream file(path);
+			return static_cast<bool>(std::getline(file, line));
+		}
+
+		inline int parseNumber(const std::string& s, size_t& pos)
+		{
+			const size_t begin = pos;
+			long long value{ 0 };
+			while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9' && value <= 1000000)
+				value = value * 10 + (s[pos++] - '0');
+			if (pos == begin || value > 1000000)
+				throw std::invalid_argument("bad cpu list: " + s);
+			return static_cast<int>(value);
+		}
+
+		inline std::string trim(const std::string& s)
+		{
+			const size_t first = s.find_first_not_of(" \t\r\n");
+			if (first == std::string::npos)
+				return std::string();
+			return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+		}
+	}
+
+	inline topology::topology(std::vector<cpu> cpus, size_t numNodes)
+		: _cpus(std::move(cpus)), _nodes(numNodes)
+	{
+		std::sort(_cpus.begin(), _cpus.end(), [](const cpu& a, const cpu& b) { return a.id < b.id; });
+		for (const auto& c : _cpus)
+		{
+			if (c.id < 0 || c.node < 0)
+				throw std::invalid_argument("topology: a cpu needs an id and a node");
+			if (static_cast<size_t>(c.node) >= _nodes.size())
+				_nodes.resize(static_cast<size_t>(c.node) + 1);
+			_nodes[static_cast<size_t>(c.node)].push_back(c.id);
+		}
+	}
+
+	inline topology topology::discover(const std::string& root)
+	{
+		// a file that is missing or not what we expect is skipped, the defaults stay
+		auto readList = [](const std::string& path) {
+			std::string line;
+			if (!detail::readFirstLine(path, line))
+				return std::vector<int>();
+			try
+			{
+				return parseCpuList(line);
+			}
+			catch (std::invalid_argument&)
+			{
+				return std::vector<int>();
+			}
+		};
+		auto readInt = [](const std::string& path, int def) {
+			std::string line;
+			if (!detail::readFirstLine(path, line))
+				return def;
+			try
+			{
+				return std::stoi(line);
+			}
+			catch (std::exception&)
+			{
+				return def;
+			}
+		};
+
+		std::vector<int> online = readList(root + "/cpu/online");
+		if (online.empty())
+		{
+			for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+				online.push_back(static_cast<int>(i));
+		}
+		std::vector<cpu> cpus;
+		cpus.reserve(online.size());
+		for (int id : online)
+		{
+			const std::string dir = root + "/cpu/cpu" + std::to_string(id) + "/topology/";
+			cpus.push_back({ id, 0, readInt(dir + "core_id", id), readInt(dir + "physical_package_id", 0) });
+
+			// the highest level that is not an instruction cache
+			int level{ 0 };
+			for (int index = 0; index < 16; ++index)
+			{
+				const std::string cache = root + "/cpu/cpu" + std::to_string(id) + "/cache/index" + std::to_string(index) + "/";
+				std::string type;
+				const int l = readInt(cache + "level", -1);
+				if (l < 0)
+					break;
+				if (l <= level || (detail::readFirstLine(cache + "type", type) && detail::trim(type) == "Instruction"))
+					continue;
+				const std::vector<int> shared = readList(cache + "shared_cpu_list");
+				if (!shared.empty())
+				{
+					level = l;
+					cpus.back().cache = shared.front();
+				}
+			}
+		}
+
+		const std::vector<int> nodes = readList(root + "/node/online");
+		for (int node : nodes)
+		{
+			for (int id : readList(root + "/node/node" + std::to_string(node) + "/cpulist"))
+			{
+				auto it = std::lower_bound(cpus.begin(), cpus.end(), id, [](const cpu& c, int v) { return c.id < v; });
+				if (it != cpus.end() && it->id == id)
+					it->node = node;
+			}
+		}
+		return topology{ std::move(cpus), nodes.empty() ? 0 : static_cast<size_t>(nodes.back()) + 1 };
+	}
+
+	inline std::vector<int> topology::parseCpuList(const std::string& list)
+	{
+		std::vector<int> res;
+		const std::string s = detail::trim(list);
+		size_t pos{ 0 };
+		while (pos < s.size())
+		{
+			const int first = detail::parseNumber(s, pos);
+			int last = first;
+			if (pos < s.size() && s[pos] == '-')
+				last = detail::parseNumber(s, ++pos);
+			if (last < first || (pos < s.size() && s[pos] != ','))
+				throw std::invalid_argument("bad cpu list: " + list);
+			if (pos < s.size() && ++pos == s.size())
+				throw std::invalid_argument("bad cpu list: " + list);	// a trailing comma
+			for (int i = first; i <= last; ++i)
+				res.push_back(i);
+		}
+		std::sort(res.begin(), res.end());
+		res.erase(std::unique(res.begin(), res.end()), res.end());
+		return res;
+	}
+
+	inline const topology::cpu* topology::find(int cpuId)const
+	{
+		auto it = std::lower_bound(_cpus.begin(), _cpus.end(), cpuId, [](const cpu& c, int v) { return c.id < v; });
+		return it != _cpus.end() && it->id == cpuId ? &*it : nullptr;
+	}
+
+	inline int topology::nodeOf(int cpuId)const
+	{
+		const cpu* c = find(cpuId);
+		return c != nullptr ? c->node : -1;
+	}
+
+	inline std::vector<int> topology::siblingsOf(int cpuId)const
+	{
+		std::vector<int> res;
+		const cpu* c = find(cpuId);
+		if (c == nullptr)
+			return res;
+		for (const auto& other : _cpus)
+		{
+			if (other.package == c->package && other.core == c->core)
+				res.push_back(other.id);
+		}
+		return res;
+	}
+
+	inline std::vector<int> topology::cacheSiblingsOf(int cpuId)const
+	{
+		const cpu* c = find(cpuId);
+		if (c == nullptr)
+			return std::vector<int>();
+		if (c->cache < 0)
+			return std::vector<int>{ cpuId };
+		std::vector<int> res;
+		for (const auto& other : _cpus)
+		{
+			if (other.cache == c->cache)
+				res.push_back(other.id);
+		}
+		return res;
+	}
+
+	inline affinity_spec& affinity_spec::addCpus(const std::vector<int>& cpus)
+	{
+		if (cpus.empty())
+			throw std::invalid_argument("affinity_spec: no cpus");
+		for (int c : cpus)
+			addCpuSet({ c }, 1);
+		return *this;
+	}
+
+	inline affinity_spec& affinity_spec::addCpuSet(const std::vector<int>& cpus, size_t count)
+	{
+		if (cpus.empty() || count == 0)
+			throw std::invalid_argument("affinity_spec: no cpus or no workers");
+		if (*std::min_element(cpus.begin(), cpus.end()) < 0)
+			throw std::invalid_argument("affinity_spec: negative cpu");
+		const int node = nodeOf(cpus);
+		for (size_t i = 0; i < count; ++i)
+			_workers.push_back({ cpus, node });
+		return *this;
+	}
+
+	inline affinity_spec& affinity_spec::addNode(int node, size_t count)
+	{
+		if (node < 0 || static_cast<size_t>(node) >= _topo.nodes() || _topo.cpusOf(static_cast<size_t>(node)).empty())
+			throw std::invalid_argument("affinity_spec: node " + std::to_string(node) + " has no cpus");
+		const auto& cpus = _topo.cpusOf(static_cast<size_t>(node));
+		return addCpuSet(cpus, count != 0 ? count : cpus.size());
+	}
+
+	inline affinity_spec affinity_spec::parse(const std::string& spec, topology topo)
+	{
+		affinity_spec res{ std::move(topo) };
+		size_t begin{ 0 };
+		while (begin <= spec.size())
+		{
+			const size_t end = std::min(spec.find(';', begin), spec.size());
+			const std::string entry = detail::trim(spec.substr(begin, end - begin));
+			begin = end + 1;
+			if (entry.empty())
+				continue;
+
+			const size_t colon = entry.find(':');
+			if (colon == std::string::npos)
+				throw std::invalid_argument("affinity_spec: expected cpu:, node: or set: in " + entry);
+			const std::string kind = detail::trim(entry.substr(0, colon));
+			std::string list = entry.substr(colon + 1);
+			size_t count{ 0 };
+			if (const size_t star = list.find('*'); star != std::string::npos)
+			{
+				size_t pos{ 0 };
+				const std::string n = detail::trim(list.substr(star + 1));
+				count = static_cast<size_t>(detail::parseNumber(n, pos));
+				if (pos != n.size() || count == 0)
+					throw std::invalid_argument("affinity_spec: bad count in " + entry);
+				list.erase(star);
+			}
+			const std::vector<int> ids = topology::parseCpuList(list);
+			if (ids.empty())
+				throw std::invalid_argument("affinity_spec: empty list in " + entry);
+
+			if (kind == "cpu")
+			{
+				if (count != 0)
+					throw std::invalid_argument("affinity_spec: a cpu: entry is a worker per cpu, no count in " + entry);
+				res.addCpus(ids);
+			}
+			else if (kind == "node")
+			{
+				for (int node : ids)
+					res.addNode(node, count);
+			}
+			else if (kind == "set")
+				res.addCpuSet(ids, count != 0 ? count : ids.size());
+			else
+				throw std::invalid_argument("affinity_spec: unknown entry " + entry);
+		}
+		return res;
+	}
+
+	inline int affinity_spec::nodeOf(const std::vector<int>& cpus)const
+	{
+		const int node = _topo.nodeOf(cpus.front());
+		for (int c : cpus)
+		{
+			if (_topo.nodeOf(c) != node)
+				return -1;
+		}
+		return node;
+	}
+}
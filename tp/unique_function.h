@@ -0,0 +1,140 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+namespace concurency
+{
+	template<typename Sig, size_t bufferSize = 56>
+	class unique_function;
+
+	/*
+		move only std::function.
+		callables up to bufferSize bytes that can be moved without exceptions are stored inline,
+		bigger ones are allocated on the heap.
+		with the default bufferSize the whole object is one cache line.
+
+		being move only it can hold move only callables, e.g. a lambda that captured an std::promise.
+	*/
+	template<typename R, typename... Args, size_t bufferSize>
+	class unique_function<R(Args...), bufferSize> final
+	{
+	public:
+		unique_function() noexcept = default;
+		unique_function(std::nullptr_t) noexcept {}
+
+		template<typename F, typename = std::enable_if_t<
+			!std::is_same_v<std::decay_t<F>, unique_function> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+		unique_function(F&& f)
+		{
+			using fn_t = std::decay_t<F>;
+			if constexpr (fitsInline<fn_t>())
+				new (_buffer) fn_t(std::forward<F>(f));
+			else
+				new (_buffer) fn_t*(new fn_t(std::forward<F>(f)));
+			_vtable = &vtableFor<fn_t>;
+		}
+
+		unique_function(unique_function&& rHnd) noexcept { moveFrom(rHnd); }
+		unique_function& operator=(unique_function&& rHnd) noexcept
+		{
+			if (this != &rHnd)
+			{
+				reset();
+				moveFrom(rHnd);
+			}
+			return *this;
+		}
+		unique_function& operator=(std::nullptr_t) noexcept
+		{
+			reset();
+			return *this;
+		}
+		~unique_function() { reset(); }
+
+		R operator()(Args... args)
+		{
+			if (_vtable == nullptr)
+				throw std::bad_function_call();
+			return _vtable->invoke(_buffer, std::forward<Args>(args)...);
+		}
+
+		explicit operator bool()const noexcept { return _vtable != nullptr; }
+
+		template<typename F>
+		static constexpr bool fitsInline()
+		{
+			return sizeof(F) <= bufferSize && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+		}
+
+	private:
+		struct vtable
+		{
+			R(*invoke)(void* buffer, Args&&... args);
+			void(*move)(void* dst, void* src) noexcept;	// move constructs dst, destroys src
+			void(*destroy)(void* buffer) noexcept;
+		};
+
+		template<typename F>
+		static F& target(void* buffer)
+		{
+			if constexpr (fitsInline<F>())
+				return *std::launder(static_cast<F*>(buffer));
+			else
+				return **std::launder(static_cast<F**>(buffer));
+		}
+
+		template<typename F>
+		static constexpr vtable vtableFor{
+			[](void* buffer, Args&&... args) -> R {
+				if constexpr (std::is_void_v<R>)
+					std::invoke(target<F>(buffer), std::forward<Args>(args)...);	// the result is dropped, like std::function
+				else
+					return std::invoke(target<F>(buffer), std::forward<Args>(args)...);
+			},
+			[](void* dst, void* src) noexcept {
+				if constexpr (fitsInline<F>())
+				{
+					F& from = target<F>(src);
+					new (dst) F(std::move(from));
+					from.~F();
+				}
+				else
+					new (dst) F*(*std::launder(static_cast<F**>(src)));
+			},
+			[](void* buffer) noexcept {
+				if constexpr (fitsInline<F>())
+					target<F>(buffer).~F();
+				else
+					delete &target<F>(buffer);
+			}
+		};
+
+		void moveFrom(unique_function& rHnd) noexcept
+		{
+			if (rHnd._vtable == nullptr)
+				return;
+			rHnd._vtable->move(_buffer, rHnd._buffer);
+			_vtable = rHnd._vtable;
+			rHnd._vtable = nullptr;
+		}
+
+		void reset() noexcept
+		{
+			if (_vtable == nullptr)
+				return;
+			_vtable->destroy(_buffer);
+			_vtable = nullptr;
+		}
+
+		alignas(std::max_align_t) unsigned char _buffer[bufferSize];
+		const vtable* _vtable{ nullptr };
+
+		unique_function(const unique_function&) = delete;
+		unique_function& operator=(const unique_function&) = delete;
+	};
+}